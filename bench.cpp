@@ -0,0 +1,1108 @@
+// Benchmark suite for the creation, draw and undo paths.
+//   cmake --build build --target diagram_bench
+//   ./build/diagram_bench --max-scale=1000000 --format=json > bench.json
+//   ./build/diagram_bench --verify   (correctness checks; exits non-zero on failure, run by ctest)
+#include "diagram/diagram.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace diagram;
+
+using Clock = chrono::steady_clock;
+
+// Stopwatch handed to each benchmark so setup and teardown stay out of the measurement
+class BenchTimer {
+    Clock::time_point started;
+    double elapsedNs = 0;
+public:
+    void start() { started = Clock::now(); }
+    void stop() { elapsedNs += chrono::duration<double, nano>(Clock::now() - started).count(); }
+    double ns() const { return elapsedNs; }
+};
+
+struct BenchCase {
+    string name;
+    // Performs `scale` operations and returns how many it measured
+    function<size_t(size_t scale, BenchTimer& timer)> run;
+};
+
+struct BenchResult {
+    string name;
+    size_t scale, iterations, operations;
+    double totalNs;
+    double nsPerOp() const { return operations ? totalNs / operations : 0; }
+};
+
+size_t benchGetDiagram(size_t scale, BenchTimer& timer) {
+    DiagramFactory df;
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) {
+        string coord = "(" + to_string(i % 1000) + "," + to_string(i / 1000) + ")";
+        if (i % 2) df.getDiagram("Graph", i % 4 == 1 ? "Bar" : "Line", coord);
+        else df.getDiagram("Figure", i % 4 == 0 ? "CircleColor" : "SquareBW", coord);
+    }
+    timer.stop();
+    return scale;
+}
+
+size_t benchFlyweightHit(size_t scale, BenchTimer& timer) {
+    FlyweightFactory factory;
+    factory.getFigure("CircleColor");
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) factory.getFigure("CircleColor");
+    timer.stop();
+    return scale;
+}
+
+size_t benchFlyweightMiss(size_t scale, BenchTimer& timer) {
+    FlyweightFactory factory;
+    vector<string> types;
+    types.reserve(scale);
+    for (size_t i = 0; i < scale; ++i) types.push_back("Shape" + to_string(i) + (i % 2 ? "Color" : "BW"));
+    timer.start();
+    for (auto& t : types) factory.getFigure(t);
+    timer.stop();
+    return scale;
+}
+
+size_t benchDirectorConstruct(size_t scale, BenchTimer& timer) {
+    Director director;
+    director.setBuilder(&BarBuilder::getInstance());
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) director.construct("Bar", "(15,30)");
+    timer.stop();
+    return scale;
+}
+
+// Same construction through the compile-time director; compare with Director_construct
+size_t benchStaticDirectorConstruct(size_t scale, BenchTimer& timer) {
+    StaticDirector<BarBuilder> director;
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) director.construct("(15,30)");
+    timer.stop();
+    return scale;
+}
+
+// Graph type dispatch through the registry's perfect-hash table, hits and misses mixed;
+// reported per lookup. The hit count decides the result, so the lookups cannot be dropped
+size_t benchRegistryLookup(size_t scale, BenchTimer& timer) {
+    const string names[] = {"Bar", "Line", "Scatter", "Area", "Histogram", "Heatmap", "Pie", "Gantt"};
+    TypeRegistry& registry = TypeRegistry::getInstance();
+    int found = 0;
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) found += registry.graphSlot(names[i % 8]) >= 0;
+    timer.stop();
+    return found > 0 ? scale : 0;
+}
+
+// One notification delivered to `scale` subscribers; reported per delivery
+size_t benchObserverFanOut(size_t scale, BenchTimer& timer) {
+    Graph graph;
+    for (size_t i = 0; i < scale; ++i) graph.attachSubscriber(make_shared<RegSub>());
+    timer.start();
+    graph.draw();
+    timer.stop();
+    return scale;
+}
+
+// `scale` graphs undone then redone; each undo+redo pair counts as one round trip
+size_t benchUndoRedo(size_t scale, BenchTimer& timer) {
+    DiagramFactory df;
+    for (size_t i = 0; i < scale; ++i) df.createGraph(i % 2 ? "Bar" : "Line", "(1,1)");
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) df.undo();
+    for (size_t i = 0; i < scale; ++i) df.redo();
+    timer.stop();
+    return scale;
+}
+
+// Same round trips with persistent-version history: each step is a pointer swap, nothing is rebuilt
+size_t benchUndoRedoVersions(size_t scale, BenchTimer& timer) {
+    DiagramFactory df;
+    df.setHistoryMode(HistoryMode::Versions);
+    for (size_t i = 0; i < scale; ++i) df.createGraph(i % 2 ? "Bar" : "Line", "(1,1)");
+    timer.start();
+    for (size_t i = 0; i < scale; ++i) df.undo();
+    for (size_t i = 0; i < scale; ++i) df.redo();
+    timer.stop();
+    return scale;
+}
+
+// `scale` figures created in Versions mode, all within four grid cells of the spatial index;
+// every creation snapshots, so each insert lands in a cell the previous version still shares
+size_t benchDenseCellsVersions(size_t scale, BenchTimer& timer) {
+    DiagramFactory df;
+    df.setHistoryMode(HistoryMode::Versions);
+    timer.start();
+    for (size_t i = 0; i < scale; ++i)
+        df.createFigure(i % 2 ? "SquareBW" : "CircleColor", "(" + to_string(i % 60) + "," + to_string(i % 50) + ")");
+    timer.stop();
+    return scale;
+}
+
+// Jumps of `scale` versions back and forward again; each costs the same at every scale
+size_t benchVersionJump(size_t scale, BenchTimer& timer) {
+    DiagramFactory df;
+    df.setHistoryMode(HistoryMode::Versions);
+    for (size_t i = 0; i < scale; ++i) df.createGraph(i % 2 ? "Bar" : "Line", "(1,1)");
+    timer.start();
+    for (int i = 0; i < 1000; ++i) {
+        df.undo(scale);
+        df.redo(scale);
+    }
+    timer.stop();
+    return 2000;
+}
+
+// `scale` createGraph calls in flight at once on the shared executor, awaited together
+size_t benchCreateGraphAsync(size_t scale, BenchTimer& timer) {
+    GraphFactory factory;
+    timer.start();
+    vector<Task<bool>> tasks;
+    tasks.reserve(scale);
+    for (size_t i = 0; i < scale; ++i) tasks.push_back(factory.createGraphAsync(i % 2 ? "Bar" : "Line", "(1,1)"));
+    syncWait(whenAll(std::move(tasks)));
+    timer.stop();
+    return scale;
+}
+
+size_t benchExportAsync(size_t scale, BenchTimer& timer) {
+    ExportVisitor exporter;
+    vector<shared_ptr<Diagram>> diagrams;
+    for (size_t i = 0; i < scale; ++i) {
+        if (i % 2) diagrams.push_back(make_shared<Graph>());
+        else diagrams.push_back(make_shared<Figure>());
+    }
+    timer.start();
+    vector<Task<>> tasks;
+    tasks.reserve(scale);
+    for (auto& d : diagrams) tasks.push_back(exporter.exportAsync(d));
+    syncWait(whenAll(std::move(tasks)));
+    timer.stop();
+    return scale;
+}
+
+// Snapshot of a `scale`-element scene followed by one edit; the edit copies one chunk path,
+// so the cost stays flat as the scene grows
+size_t benchSnapshotEdit(size_t scale, BenchTimer& timer) {
+    Scene scene;
+    for (size_t i = 0; i < scale; ++i)
+        scene.add("Figure", "CircleColor", "(" + to_string(i % 1000) + "," + to_string(i / 1000) + ")", make_shared<Figure>());
+    timer.start();
+    for (size_t i = 0; i < 100; ++i) {
+        int id = (int)(i * 7919 % scale);
+        auto snapshot = scene.snapshot();
+        scene.move(id, "(" + to_string(id % 1000) + "," + to_string(id / 1000) + ")");
+    }
+    timer.stop();
+    return 100;
+}
+
+// `scale` documents edited at once, one graph and one figure each; documents share no locks
+size_t benchSessionEdits(size_t scale, BenchTimer& timer) {
+    Session session;
+    vector<Session::DocumentId> ids;
+    for (size_t i = 0; i < scale; ++i) ids.push_back(session.open());
+    timer.start();
+    vector<Task<bool>> tasks;
+    tasks.reserve(scale);
+    for (auto id : ids)
+        tasks.push_back(session.editAsync(id, [](DiagramFactory& df) {
+            df.createGraph("Bar", "(1,1)");
+            df.createFigure("CircleColor", "(2,2)");
+        }));
+    syncWait(whenAll(std::move(tasks)));
+    timer.stop();
+    return scale;
+}
+
+// Normally distributed points for the data kernels
+static void randomPoints(size_t n, vector<double>& xs, vector<double>& ys) {
+    mt19937 rng(7);
+    normal_distribution<double> dist;
+    xs.resize(n);
+    ys.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        xs[i] = dist(rng);
+        ys[i] = dist(rng);
+    }
+}
+
+// HistogramBuilder over `scale` values (64 bins); reported per value
+size_t benchHistogram(size_t scale, BenchTimer& timer) {
+    vector<double> xs, ys;
+    randomPoints(scale, xs, ys);
+    GraphFactory factory;
+    timer.start();
+    factory.createGraph("Histogram", "(1,1)", {xs.data(), nullptr, nullptr, scale, nullptr, AggregationSpec{}});
+    timer.stop();
+    return scale;
+}
+
+// ScatterBuilder density splat of `scale` points onto its 256x256 grid; reported per point
+size_t benchScatter(size_t scale, BenchTimer& timer) {
+    vector<double> xs, ys;
+    randomPoints(scale, xs, ys);
+    GraphFactory factory;
+    timer.start();
+    factory.createGraph("Scatter", "(1,1)", {xs.data(), ys.data(), nullptr, scale, nullptr, AggregationSpec{}});
+    timer.stop();
+    return scale;
+}
+
+// BarBuilder summing `scale` raw rows over 10k keys, keeping the top 20 bars; reported per row
+size_t benchBarAggregate(size_t scale, BenchTimer& timer) {
+    vector<double> xs, ys;
+    randomPoints(scale, xs, ys);
+    vector<int64_t> keys(scale);
+    mt19937 rng(11);
+    uniform_int_distribution<int64_t> key(0, 9999);
+    for (auto& k : keys) k = key(rng);
+    GraphData data{nullptr, ys.data(), nullptr, scale, keys.data(), {Aggregate::Sum, 20}};
+    GraphFactory factory;
+    timer.start();
+    factory.createGraph("Bar", "(1,1)", data);
+    timer.stop();
+    return scale;
+}
+
+// Streaming LineBuilder: a producer thread appends `scale` points while this thread refreshes a
+// 1000-point window; reported per point
+size_t benchLineStream(size_t scale, BenchTimer& timer) {
+    LineBuilder line;
+    line.setCoord("(1,1)");
+    line.startStream(4096, 1000);
+    LiveSeries* series = line.stream();
+    timer.start();
+    thread producer([&] {
+        for (size_t i = 0; i < scale; ++i)
+            while (!series->append((double)i, (double)(i % 360))) this_thread::yield();
+    });
+    for (size_t shown = 0; shown < scale;) shown += line.refresh().added;
+    producer.join();
+    timer.stop();
+    return scale;
+}
+
+// In-process network for the collaboration bench: every batch reaches every other replica,
+// in shuffled order and sometimes twice
+struct SimulatedNetwork {
+    struct Packet {
+        size_t to;
+        string batch;
+    };
+    vector<Packet> inFlight;
+    mt19937 rng{42};
+
+    void broadcast(size_t from, size_t replicas, const string& batch) {
+        for (size_t to = 0; to < replicas; ++to) {
+            if (to == from) continue;
+            inFlight.push_back({to, batch});
+            if (rng() % 8 == 0) inFlight.push_back({to, batch});
+        }
+    }
+    template <typename Deliver>
+    void deliverAll(Deliver deliver) {
+        shuffle(inFlight.begin(), inFlight.end(), rng);
+        for (auto& p : inFlight) deliver(p.to, p.batch);
+        inFlight.clear();
+    }
+};
+
+// Four replicas with `scale` ops of shared history each; times merging one round of 64
+// concurrent ops per replica, reported per merged op
+size_t benchCollabMerge(size_t scale, BenchTimer& timer) {
+    constexpr size_t kReplicas = 4, kRound = 64;
+    vector<unique_ptr<DiagramFactory>> docs;
+    vector<unique_ptr<Replica>> replicas;
+    for (size_t r = 0; r < kReplicas; ++r) {
+        docs.push_back(make_unique<DiagramFactory>());
+        replicas.push_back(make_unique<Replica>((uint32_t)r + 1, *docs.back()));
+    }
+    SimulatedNetwork net;
+    vector<OpId> created;
+    auto edit = [&](size_t r, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            unsigned pick = net.rng() % 10;
+            string coord = "(" + to_string(net.rng() % 500) + "," + to_string(net.rng() % 500) + ")";
+            if (created.empty() || pick < 4) {
+                bool graph = net.rng() % 2;
+                created.push_back(replicas[r]->create(graph ? "Graph" : "Figure", graph ? "Bar" : "CircleColor", coord));
+            } else if (pick < 9) {
+                replicas[r]->move(created[net.rng() % created.size()], coord);
+            } else {
+                replicas[r]->remove(created[net.rng() % created.size()]);
+            }
+        }
+    };
+    size_t merged = 0;
+    auto exchange = [&] {
+        for (size_t r = 0; r < kReplicas; ++r) {
+            string batch = replicas[r]->takeOutgoing();
+            if (!batch.empty()) net.broadcast(r, kReplicas, batch);
+        }
+        net.deliverAll([&](size_t to, const string& batch) { merged += (size_t)max(0L, replicas[to]->merge(batch)); });
+    };
+    for (size_t done = 0; done < scale; done += kRound) {
+        for (size_t r = 0; r < kReplicas; ++r) edit(r, min(kRound, scale - done));
+        exchange();
+    }
+    for (size_t r = 0; r < kReplicas; ++r) edit(r, kRound);
+    merged = 0;
+    timer.start();
+    exchange();
+    timer.stop();
+    for (auto& r : replicas)
+        if (r->pending() != 0 || r->stateHash() != replicas[0]->stateHash()) fprintf(stderr, "Collab_merge: replicas diverged\n");
+    return merged;
+}
+
+// Verification - each check prints what failed and returns false
+struct VerifyCase {
+    string name;
+    function<bool()> run;
+};
+
+static bool expect(bool ok, const string& what) {
+    if (!ok) fprintf(stderr, "  FAILED: %s\n", what.c_str());
+    return ok;
+}
+
+// Journal and snapshot paths in the temp directory, removed before and after a check
+struct JournalFiles {
+    string journal, snapshot;
+    explicit JournalFiles(const string& name) {
+        auto dir = filesystem::temp_directory_path();
+        journal = (dir / (name + ".journal")).string();
+        snapshot = (dir / (name + ".scene")).string();
+        clear();
+    }
+    ~JournalFiles() { clear(); }
+    void clear() {
+        error_code ignored;
+        filesystem::remove(journal, ignored);
+        filesystem::remove(snapshot, ignored);
+    }
+};
+
+// Edits, a checkpoint, more edits and an undo, then a crash (the factory is dropped) and recovery
+// into a fresh factory in the same history mode
+bool verifyRecovery(HistoryMode mode, const string& name) {
+    JournalFiles files(name);
+    JournalOptions options;
+    options.batchSize = 1;
+    options.snapshotInterval = 0;
+    size_t before;
+    {
+        DiagramFactory df;
+        df.setHistoryMode(mode);
+        if (!expect(df.enableJournal(files.journal, files.snapshot, options), "enableJournal")) return false;
+        df.createGraph("Bar", "(1,1)");
+        df.createFigure("CircleColor", "(2,2)");
+        df.checkpoint();
+        df.createGraph("Line", "(3,3)");
+        df.undo();
+        df.createFigure("SquareBW", "(4,4)");
+        before = df.getScene().allElements().size();
+    }
+    DiagramFactory recovered;
+    recovered.setHistoryMode(mode);
+    if (!expect(recovered.enableJournal(files.journal, files.snapshot, options), "recovery enableJournal")) return false;
+    size_t after = recovered.getScene().allElements().size();
+    bool ok = expect(before == 3 && after == before,
+                     "recovered " + to_string(after) + " elements, expected " + to_string(before) + " (3)");
+    // Recovering again, or into a document that already has content, would duplicate elements
+    ok &= expect(!recovered.enableJournal(files.journal, files.snapshot, options), "second enableJournal accepted");
+    DiagramFactory busy;
+    busy.setHistoryMode(mode);
+    busy.createGraph("Bar", "(1,1)");
+    ok &= expect(!busy.enableJournal(files.journal, files.snapshot, options), "enableJournal on a non-empty document accepted");
+    return ok & expect(recovered.getScene().allElements().size() == after && busy.getScene().allElements().size() == 1,
+                       "rejected enableJournal changed the document");
+}
+
+// An undo right after a checkpoint: Versions mode cannot step back past the snapshot, and the
+// live document must agree with what recovery rebuilds
+bool verifyUndoAcrossCheckpoint(HistoryMode mode, const string& name) {
+    JournalFiles files(name);
+    JournalOptions options;
+    options.batchSize = 1;
+    options.snapshotInterval = 0;
+    size_t live;
+    {
+        DiagramFactory df;
+        df.setHistoryMode(mode);
+        if (!expect(df.enableJournal(files.journal, files.snapshot, options), "enableJournal")) return false;
+        df.createGraph("Bar", "(1,1)");
+        df.createGraph("Line", "(3,3)");
+        df.checkpoint();
+        df.undo();
+        live = df.getScene().allElements().size();
+    }
+    DiagramFactory recovered;
+    recovered.setHistoryMode(mode);
+    if (!expect(recovered.enableJournal(files.journal, files.snapshot, options), "recovery enableJournal")) return false;
+    size_t after = recovered.getScene().allElements().size();
+    return expect(live == after, "live document has " + to_string(live) + " elements, recovered " + to_string(after));
+}
+
+static string readBytes(const string& path) {
+    ifstream file(path, ios::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+static void writeBytes(const string& path, const string& bytes) {
+    ofstream(path, ios::binary | ios::trunc).write(bytes.data(), (streamsize)bytes.size());
+}
+
+// Scene file round trip: every element record, series blob and interned string read back
+// from the mapped view, culling straight off the table, and damaged files refused on open
+bool verifySceneFile() {
+    JournalFiles files("diagram_verify_scene_file");
+    const string& path = files.snapshot;
+    Scene scene;
+    for (int i = 0; i < 40; ++i) {
+        string coord = "(" + to_string(i * 7 % 90) + "," + to_string(i * 13 % 90) + ")";
+        int id = scene.add(i % 3 ? "Figure" : "Graph", i % 2 ? "CircleColor" : "Bar", coord, nullptr);
+        if (i % 4 == 0) scene.setStyle(id, "bold");
+        if (i % 5 == 0) scene.bindSeries(id, i % 10 ? "load" : "temperature");
+        if (i % 6 == 0) scene.linkAxis(id, "left");
+    }
+    scene.remove(7);
+    scene.updateSeries("load", {1.5, -2, 1e300});
+    scene.updateSeries("temperature", {20, 21.5});
+    scene.setAxis("left", {-5, 5, false});
+    if (!expect(writeSceneFile(scene, path, 42), "writeSceneFile")) return false;
+    auto view = SceneView::open(path);
+    if (!expect(view != nullptr, "written file did not open")) return false;
+
+    bool ok = expect(view->journalSeq() == 42, "journal sequence lost");
+    ok &= expect(view->elementCount() == scene.size(), "element count differs");
+    auto text = [&](uint32_t offset) { return offset == kNoString ? string() : string(view->str(offset)); };
+    unordered_map<string, uint32_t> offsets;
+    for (size_t i = 0; i < view->elementCount(); ++i) {
+        auto& r = view->element(i);
+        const SceneElement* e = scene.allElements().get(r.id);
+        if (!expect(e != nullptr, "record " + to_string(r.id) + " is not in the scene")) return false;
+        bool same = r.kind == (e->element == "Graph" ? KindGraph : KindFigure) && text(r.type) == e->type &&
+                    text(r.coord) == e->coord && text(r.style) == e->style && text(r.series) == e->series &&
+                    text(r.axisGroup) == e->axisGroup && r.dependsOn == e->dependsOn && r.minX == e->bounds.minX &&
+                    r.minY == e->bounds.minY && r.maxX == e->bounds.maxX && r.maxY == e->bounds.maxY &&
+                    r.axisMin == e->axis.min && r.axisMax == e->axis.max && (r.axisAuto != 0) == e->axis.autoRange;
+        ok &= expect(same, "record " + to_string(r.id) + " differs from the scene");
+        // Interned: an equal string is stored once, so it always has the same offset
+        for (uint32_t s : {r.type, r.coord, r.style, r.series, r.axisGroup})
+            if (s != kNoString) ok &= expect(offsets.emplace(text(s), s).first->second == s, "string stored twice");
+    }
+    ok &= expect(view->seriesCount() == scene.allSeries().size(), "series count differs");
+    for (size_t i = 0; i < view->seriesCount(); ++i) {
+        const vector<double>* values = scene.seriesValues(view->str(view->series(i).name));
+        const double* data = view->seriesData(i);
+        ok &= expect(values && data && view->series(i).count == values->size() &&
+                         equal(values->begin(), values->end(), data),
+                     "series " + text(view->series(i).name) + " differs");
+    }
+
+    Bounds area{10, 10, 40, 40};
+    vector<int> culled, expected;
+    view->forEachInArea(area, [&](const SceneFileElement& r) { culled.push_back(r.id); });
+    scene.allElements().forEach([&](const SceneElement& e) {
+        if (e.bounds.intersects(area)) expected.push_back(e.id);
+    });
+    sort(culled.begin(), culled.end());
+    ok &= expect(!culled.empty() && culled == expected, "area culling off the mapped table differs");
+    view.reset();
+
+    string good = readBytes(path);
+    auto refused = [&](const string& bytes) {
+        writeBytes(path, bytes);
+        return SceneView::open(path) == nullptr;
+    };
+    auto patched = [&](size_t offset, uint64_t value, size_t width = sizeof(uint64_t)) {
+        string bytes = good;
+        memcpy(&bytes[offset], &value, width);
+        return bytes;
+    };
+    ok &= expect(refused(good.substr(0, 20)), "truncated header accepted");
+    ok &= expect(refused(good.substr(0, good.size() - 8)), "truncated file accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, magic), 0)), "corrupt magic accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, version), 99, sizeof(uint32_t))), "unknown version accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, elementOffset), good.size())), "element table past the end accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, elementCount), 1ull << 60)), "huge element count accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, seriesOffset), ~0ull)), "series table offset overflow accepted");
+    ok &= expect(refused(patched(offsetof(SceneFileHeader, stringTableOffset), good.size() - 2)), "string table past the end accepted");
+    // A series blob outside the file is reported as missing rather than read
+    SceneFileHeader h;
+    memcpy(&h, good.data(), sizeof h);
+    writeBytes(path, patched(h.seriesOffset + offsetof(SceneFileSeries, dataOffset), good.size()));
+    view = SceneView::open(path);
+    ok &= expect(view && !view->seriesData(0), "series blob past the end returned");
+    return ok;
+}
+
+// Four replicas editing concurrently for many rounds over the shuffling, duplicating network
+// must end with identical state and nothing left waiting
+bool verifyCollabConvergence() {
+    constexpr size_t kReplicas = 4;
+    vector<unique_ptr<DiagramFactory>> docs;
+    vector<unique_ptr<Replica>> replicas;
+    for (size_t r = 0; r < kReplicas; ++r) {
+        docs.push_back(make_unique<DiagramFactory>());
+        replicas.push_back(make_unique<Replica>((uint32_t)r + 1, *docs.back()));
+    }
+    SimulatedNetwork net;
+    vector<OpId> created;
+    for (int round = 0; round < 50; ++round) {
+        for (size_t r = 0; r < kReplicas; ++r) {
+            for (int i = 0; i < 16; ++i) {
+                unsigned pick = net.rng() % 10;
+                string coord = "(" + to_string(net.rng() % 100) + "," + to_string(net.rng() % 100) + ")";
+                if (created.empty() || pick < 4) {
+                    bool graph = net.rng() % 2;
+                    created.push_back(replicas[r]->create(graph ? "Graph" : "Figure", graph ? "Bar" : "CircleColor", coord));
+                } else if (pick < 9) {
+                    replicas[r]->move(created[net.rng() % created.size()], coord);
+                } else {
+                    replicas[r]->remove(created[net.rng() % created.size()]);
+                }
+            }
+            string batch = replicas[r]->takeOutgoing();
+            if (!batch.empty()) net.broadcast(r, kReplicas, batch);
+        }
+        // Deliver only part of the traffic some rounds, so later batches overtake earlier ones
+        if (round % 3 != 2) continue;
+        net.deliverAll([&](size_t to, const string& batch) { replicas[to]->merge(batch); });
+    }
+    net.deliverAll([&](size_t to, const string& batch) { replicas[to]->merge(batch); });
+    bool ok = true;
+    for (size_t r = 0; r < kReplicas; ++r) {
+        ok &= expect(replicas[r]->pending() == 0, "replica " + to_string(r + 1) + " still has ops waiting");
+        ok &= expect(replicas[r]->stateHash() == replicas[0]->stateHash(), "replica " + to_string(r + 1) + " diverged");
+    }
+    return ok;
+}
+
+// Moves and removes that arrive before the create they target wait for it; duplicated and
+// malformed batches change nothing
+bool verifyCollabCausalGap() {
+    DiagramFactory docA, docB;
+    Replica a(1, docA), b(2, docB);
+    OpId kept = a.create("Graph", "Line", "(1,1)");
+    OpId dropped = a.create("Figure", "SquareBW", "(2,2)");
+    string creates = a.takeOutgoing();
+    a.move(kept, "(5,5)");
+    string moves = a.takeOutgoing();
+    a.remove(dropped);
+    string removes = a.takeOutgoing();
+
+    bool ok = true;
+    ok &= expect(b.merge(removes) == 0 && b.merge(moves) == 0, "ops applied before their create");
+    ok &= expect(b.pending() == 2, "early ops not held back");
+    ok &= expect(b.merge(creates) == 4, "held ops not applied once their create arrived");
+    ok &= expect(b.merge(moves) == 0 && b.merge(creates) == 0, "duplicate batch applied again");
+    ok &= expect(b.merge(creates.substr(0, creates.size() / 2)) == -1, "truncated batch accepted");
+    ok &= expect(b.pending() == 0 && b.stateHash() == a.stateHash(), "replicas diverged");
+    ok &= expect(b.sceneId(dropped) < 0, "removed element still live");
+    const SceneElement* e = docB.getScene().allElements().get(b.sceneId(kept));
+    ok &= expect(e && e->coord == "(5,5)", "move lost");
+    return ok;
+}
+
+// Elements at non-finite or astronomically large coordinates stay queryable and removable,
+// and culling a camera zoomed out that far neither hangs nor misses them
+bool verifySceneExtremeBounds() {
+    Scene scene;
+    int nan = scene.add("Graph", "Line", "(nan,0)", nullptr);
+    int far = scene.add("Figure", "SquareBW", "(1e300,1e300)", nullptr);
+    int below = scene.add("Figure", "SquareBW", "(-1e300,5)", nullptr);
+    int inf = scene.add("Figure", "SquareBW", "(inf,0)", nullptr);
+    scene.add("Graph", "Line", "(10,10)", nullptr);
+    bool ok = expect(scene.visibleElements().size() == 1, "default camera sees the far-away elements");
+    scene.viewport().zoom(1e-299);
+    ok &= expect(scene.visibleElements().size() == 3, "zoomed-out camera misses the far-away elements");
+    for (int id : {nan, far, below, inf}) scene.remove(id);
+    ok &= expect(scene.size() == 1 && scene.visibleElements().size() == 1, "far-away elements not removed");
+    return ok;
+}
+
+// A snapshot keeps rendering and reporting the scene as it was while the editor adds, removes
+// and moves elements in several of the 32-element chunks it shares with the snapshot
+bool verifySnapshotUnchanged() {
+    DiagramFactory df;
+    Scene& scene = df.getScene();
+    constexpr int kFigures = 200;
+    for (int i = 0; i < kFigures; ++i)
+        df.createFigure(i % 2 ? "CircleColor" : "SquareBW", "(" + to_string(i % 20 * 5) + "," + to_string(i / 20 * 9) + ")");
+    SceneSnapshot snapshot = scene.snapshot();
+    vector<SceneElement> before;
+    snapshot.allElements().forEach([&](const SceneElement& e) { before.push_back(e); });
+    Viewport camera;
+    Canvas original, frame;
+    snapshot.render(camera, original);
+
+    for (int id : {3, 40, 77, 150}) scene.remove(id);
+    for (int id : {5, 70, 130, 199}) scene.move(id, "(" + to_string(id % 7 * 13) + ",97)");
+    for (int i = 0; i < 40; ++i) df.createFigure("CircleColor", "(" + to_string(i * 2) + ",50)");
+
+    bool ok = expect(before.size() == kFigures && original.data() != Canvas(100, 100).data(), "nothing to compare");
+    ok &= expect(snapshot.size() == kFigures && !snapshot.element(kFigures), "snapshot element count changed");
+    bool same = true;
+    for (const SceneElement& e : before) {
+        const SceneElement* now = snapshot.element(e.id);
+        same &= now && now->type == e.type && now->coord == e.coord && now->bounds.minX == e.bounds.minX &&
+                now->bounds.minY == e.bounds.minY && now->flyweight == e.flyweight;
+    }
+    ok &= expect(same, "snapshot elements changed");
+    snapshot.render(camera, frame);
+    ok &= expect(frame.data() == original.data(), "snapshot renders differently");
+    scene.snapshot().render(camera, frame);
+    ok &= expect(scene.size() == kFigures + 36 && frame.data() != original.data(), "edits did not reach the scene");
+    return ok;
+}
+
+static bool nearlyEqual(double a, double b) { return fabs(a - b) <= 1e-9 * max(1.0, fabs(b)); }
+
+// Parallel group-by against a serial std::map reference, for every aggregate and with topN;
+// half the keys are multiples of 2^16, which a weak slot hash piles onto a few slots
+bool verifyAggregate() {
+    constexpr size_t kRows = 300000;
+    mt19937 rng(5);
+    uniform_int_distribution<int64_t> key(-5000, 5000);
+    uniform_real_distribution<double> value(-100, 100);
+    vector<int64_t> keys(kRows);
+    vector<double> values(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+        keys[i] = i % 2 ? key(rng) : key(rng) * (int64_t(1) << 16);
+        values[i] = value(rng);
+    }
+    struct Group {
+        double count = 0, sum = 0, lo = INFINITY, hi = -INFINITY;
+    };
+    map<int64_t, Group> reference;
+    for (size_t i = 0; i < kRows; ++i) {
+        Group& g = reference[keys[i]];
+        ++g.count;
+        g.sum += values[i];
+        g.lo = min(g.lo, values[i]);
+        g.hi = max(g.hi, values[i]);
+    }
+    auto expected = [](Aggregate fn, const Group& g) {
+        switch (fn) {
+        case Aggregate::Count: return g.count;
+        case Aggregate::Sum: return g.sum;
+        case Aggregate::Mean: return g.sum / g.count;
+        case Aggregate::Min: return g.lo;
+        case Aggregate::Max: return g.hi;
+        }
+        return 0.0;
+    };
+    const char* names[] = {"Count", "Sum", "Mean", "Min", "Max"};
+    bool ok = true;
+    for (Aggregate fn : {Aggregate::Count, Aggregate::Sum, Aggregate::Mean, Aggregate::Min, Aggregate::Max}) {
+        string what = names[(int)fn];
+        GroupedValues all = aggregate(keys.data(), values.data(), kRows, {fn, 0});
+        bool same = all.keys.size() == reference.size();
+        size_t i = 0;
+        for (auto it = reference.begin(); same && it != reference.end(); ++it, ++i)
+            same = all.keys[i] == it->first && nearlyEqual(all.values[i], expected(fn, it->second));
+        ok &= expect(same, what + " differs from the serial reference");
+
+        vector<pair<double, int64_t>> ranked;
+        for (auto& [k, g] : reference) ranked.push_back({-expected(fn, g), k});
+        sort(ranked.begin(), ranked.end());
+        GroupedValues top = aggregate(keys.data(), values.data(), kRows, {fn, 20});
+        same = top.keys.size() == 20;
+        for (size_t j = 0; same && j < 20; ++j) same = nearlyEqual(top.values[j], -ranked[j].first);
+        ok &= expect(same, what + " top 20 differs from the serial reference");
+    }
+    return ok;
+}
+
+// Serial restatement of the binning the data kernels use: finite values only, halved so the
+// ±1e308 extremes keep a finite width, clamped into [0, cells)
+static int referenceBin(double v, ValueRange r, int cells, int flat) {
+    double width = r.max * 0.5 - r.min * 0.5;
+    if (!(width > 0)) return flat;
+    double scaled = (v * 0.5 - r.min * 0.5) * (cells / width);
+    return scaled < 0 ? 0 : scaled >= cells - 1 ? cells - 1 : (int)scaled;
+}
+
+static ValueRange referenceRange(const vector<double>& values) {
+    ValueRange r{INFINITY, -INFINITY};
+    for (double v : values)
+        if (isfinite(v)) r = {min(r.min, v), max(r.max, v)};
+    return r.min <= r.max ? r : ValueRange{};
+}
+
+// Parallel histogram/splat/areaProfile (several chunks past the parallelFor grain) against a
+// serial reference, on data salted with NaN and infinities and on data spanning ±1e308
+bool verifyDataKernels() {
+    constexpr size_t kPoints = 300000;
+    constexpr int kBins = 64, kWidth = 48, kHeight = 32;
+    mt19937 rng(9);
+    uniform_real_distribution<double> unit(-1, 1);
+    vector<double> xs(kPoints), ys(kPoints), weights(kPoints);
+    for (size_t i = 0; i < kPoints; ++i) {
+        xs[i] = i * 0.01;
+        ys[i] = 100 * unit(rng);
+        weights[i] = 1 + unit(rng);
+    }
+    vector<double> salted = ys, wide = ys;
+    for (size_t i = 17; i < kPoints; i += 9973) {
+        salted[i] = i % 3 ? NAN : (i % 2 ? INFINITY : -INFINITY);
+        wide[i] = i % 2 ? 1e308 : -1e308;
+    }
+    xs[70001] = NAN;
+    wide[5] = numeric_limits<double>::max();
+
+    bool ok = true;
+    for (auto* values : {&salted, &wide}) {
+        string what = values == &salted ? "NaN-salted" : "±1e308";
+        ValueRange r = referenceRange(*values);
+        vector<uint64_t> counts(kBins, 0);
+        for (double v : *values)
+            if (isfinite(v)) ++counts[referenceBin(v, r, kBins, kBins / 2)];
+        Histogram h = histogram(values->data(), kPoints, kBins);
+        ok &= expect(h.range.min == r.min && h.range.max == r.max, what + " histogram range differs");
+        ok &= expect(h.counts == counts, what + " histogram differs from the serial reference");
+
+        ValueRange rx = referenceRange(xs);
+        for (const double* w : {(const double*)nullptr, (const double*)weights.data()}) {
+            vector<double> cells((size_t)kWidth * kHeight, 0);
+            for (size_t i = 0; i < kPoints; ++i)
+                if (isfinite(xs[i]) && isfinite((*values)[i]))
+                    cells[referenceBin((*values)[i], r, kHeight, 0) * kWidth + referenceBin(xs[i], rx, kWidth, 0)] +=
+                        w ? w[i] : 1;
+            DensityGrid g = splat(xs.data(), values->data(), w, kPoints, kWidth, kHeight);
+            bool same = g.cells.size() == cells.size() && g.area.minY == r.min && g.area.maxX == rx.max;
+            for (size_t c = 0; same && c < cells.size(); ++c) same = nearlyEqual(g.cells[c], cells[c]);
+            ok &= expect(same, what + (w ? " weighted" : "") + " splat differs from the serial reference");
+        }
+    }
+
+    ValueRange rx = referenceRange(xs), ry = referenceRange(salted);
+    double area = 0;
+    for (size_t i = 0; i + 1 < kPoints; ++i)
+        if (isfinite(xs[i]) && isfinite(xs[i + 1]) && isfinite(salted[i]) && isfinite(salted[i + 1]))
+            area += 0.5 * (salted[i] + salted[i + 1]) * (xs[i + 1] - xs[i]);
+    vector<double> envelope(kWidth, -INFINITY);
+    for (size_t i = 0; i < kPoints; ++i)
+        if (isfinite(xs[i]) && isfinite(salted[i])) {
+            double& top = envelope[referenceBin(xs[i], rx, kWidth, 0)];
+            top = max(top, salted[i]);
+        }
+    double carry = ry.min;
+    for (double& v : envelope) carry = v = v == -INFINITY ? carry : v;
+    AreaProfile p = areaProfile(xs.data(), salted.data(), kPoints, kWidth);
+    ok &= expect(p.x.min == rx.min && p.x.max == rx.max && p.y.min == ry.min && p.y.max == ry.max,
+                 "area profile ranges differ");
+    ok &= expect(nearlyEqual(p.area, area), "area differs from the serial reference");
+    ok &= expect(p.envelope == envelope, "envelope differs from the serial reference");
+    return ok;
+}
+
+// A producer thread streams through a ring far smaller than the stream into a factory-owned
+// LineBuilder. Every refresh must show the window's points contiguous and in order, redraw only
+// the scrolled-in points unless rescaled, and rescale the y axis only when the window leaves the
+// axis or shrinks below half of it. The amplitude cycles 100, 40, 1 to force both kinds
+bool verifyLiveStream() {
+    constexpr size_t kPoints = 60000, kWindow = 100;
+    const double amplitude[] = {100, 40, 1};
+    auto sample = [&](size_t i) { return amplitude[i / 5000 % 3] * sin((double)i * 0.05); };
+    GraphFactory factory;
+    bool ok = expect(factory.builder("Nope") == nullptr, "builder for an unknown type");
+    auto* line = dynamic_cast<LineBuilder*>(factory.builder("Line"));
+    if (!expect(line && factory.builder("Line") == line, "factory has no stable Line builder")) return false;
+    line->startStream(256, kWindow);
+    LiveSeries* series = line->stream();
+    thread producer([&] {
+        for (size_t i = 0; i < kPoints; ++i)
+            while (!series->append((double)i, sample(i))) this_thread::yield();
+    });
+
+    size_t received = 0, grew = 0, shrank = 0, refreshes = 0;
+    ValueRange axis;
+    bool inOrder = true, redrawn = true, axisHeld = true;
+    while (received < kPoints) {
+        size_t before = series->size();
+        StreamUpdate u = line->refresh();
+        received += u.added;
+        ++refreshes;
+        size_t size = min(received, kWindow);
+        inOrder &= u.size == size && u.scrolledOut == before + u.added - size;
+        if (u.added == 0) continue;
+        for (size_t j = 0; inOrder && j < size; ++j) {
+            size_t i = received - size + j;
+            inOrder = series->at(j).x == (double)i && series->at(j).y == sample(i);
+        }
+        double lo = INFINITY, hi = -INFINITY;
+        for (size_t j = 0; j < size; ++j) lo = min(lo, series->at(j).y), hi = max(hi, series->at(j).y);
+        double pad = hi > lo ? (hi - lo) / 8 : (hi != 0 ? fabs(hi) / 8 : 1);
+        bool leaves = lo < axis.min || hi > axis.max;
+        bool shrunk = axis.max - axis.min > 2 * (hi - lo + 2 * pad);
+        if (u.rescaled) {
+            axisHeld &= refreshes == 1 || leaves || shrunk;
+            axisHeld &= u.y.min == lo - pad && u.y.max == hi + pad;
+            grew += refreshes > 1 && leaves;
+            shrank += !leaves && shrunk;
+            redrawn &= u.redrawFrom == 0;
+        } else {
+            axisHeld &= !leaves && !shrunk && u.y.min == axis.min && u.y.max == axis.max;
+            if (u.added > 0) redrawn &= u.size - u.redrawFrom == min(u.added, u.size) + (u.added < u.size);
+        }
+        axis = u.y;
+    }
+    producer.join();
+    ok &= expect(inOrder, "streamed points lost or reordered");
+    ok &= expect(redrawn, "redraw span is not just the scrolled-in points");
+    ok &= expect(axisHeld, "y axis rescaled when it should hold, or held when it should rescale");
+    ok &= expect(grew > 0 && shrank > 0, "stream never forced both kinds of rescale");
+    return ok & expect(line->refresh().added == 0, "points after the stream ended");
+}
+
+Task<int> failingTask() {
+    co_await Executor::getInstance().schedule();
+    throw runtime_error("task failed");
+}
+
+Task<int> catchingTask() {
+    try {
+        co_return co_await failingTask();
+    } catch (const runtime_error&) {
+        co_return -1;
+    }
+}
+
+// An exception thrown on a pool thread reaches whoever awaits the task, directly, through
+// syncWait and through whenAll, instead of terminating the process
+bool verifyAsyncThrow() {
+    bool ok = expect(syncWait(catchingTask()) == -1, "awaiting task did not catch the failure");
+    auto throws = [](auto task) {
+        try {
+            syncWait(std::move(task));
+        } catch (const runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    ok &= expect(throws(failingTask()), "syncWait did not rethrow");
+    vector<Task<int>> tasks;
+    tasks.push_back(catchingTask());
+    tasks.push_back(failingTask());
+    ok &= expect(throws(whenAll(std::move(tasks))), "whenAll did not rethrow");
+    Session session;
+    auto doc = session.open();
+    ok &= expect(throws(session.editAsync(doc, [](DiagramFactory&) { throw runtime_error("edit failed"); })),
+                 "editAsync did not rethrow");
+    ok &= expect(syncWait(session.editAsync(doc, [](DiagramFactory& df) { df.createGraph("Bar", "(1,1)"); })),
+                 "document unusable after a failed edit");
+    return ok;
+}
+
+// A chunk that throws, on a worker or on the caller, ends parallelFor with that exception
+// instead of leaving it waiting for chunks that never finish
+bool verifyParallelForThrow() {
+    Executor& executor = Executor::getInstance();
+    bool ok = true;
+    for (size_t bad : {size_t(0), size_t(9999)}) {
+        atomic<size_t> ran{0};
+        bool thrown = false;
+        try {
+            executor.parallelFor(10000, 16, [&](size_t begin, size_t end) {
+                if (begin <= bad && bad < end) throw runtime_error("chunk failed");
+                ran.fetch_add(end - begin);
+            });
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        ok &= expect(thrown, "exception from item " + to_string(bad) + " not rethrown");
+        ok &= expect(ran.load() < 10000, "failed call ran every item");
+    }
+    size_t total = 0;
+    mutex lock;
+    executor.parallelFor(10000, 16, [&](size_t begin, size_t end) {
+        lock_guard<mutex> guard(lock);
+        total += end - begin;
+    });
+    return ok & expect(total == 10000, "pool unusable after a failed call");
+}
+
+// Registry lookups stay right while types keep being registered from another thread, names the
+// registry does not know fall back to the "Color" naming rule, and superseded tables are freed:
+// every table holds a copy of the tracked maker, so its token counts the tables still alive
+bool verifyRegistryLookup() {
+    TypeRegistry& registry = TypeRegistry::getInstance();
+    auto token = make_shared<int>(0);
+    bool ok = expect(registry.registerFigure("VerifyColorBW", [token](const string& type) {
+        return make_shared<BWFigure>(type);
+    }), "new figure type rejected");
+    ok &= expect(!registry.registerFigure("VerifyColorBW", nullptr), "duplicate figure type accepted");
+    int line = registry.graphSlot("Line");
+
+    atomic<bool> done{false};
+    atomic<size_t> wrong{0};
+    thread reader([&] {
+        while (!done.load())
+            wrong += registry.graphSlot("Line") != line || registry.graphSlot("Nope") != -1 ||
+                     !dynamic_pointer_cast<BWFigure>(registry.makeFigure("VerifyColorBW"));
+    });
+    for (int i = 0; i < 200; ++i) {
+        registry.registerGraph("VerifyGraph" + to_string(i), [] { return unique_ptr<Builder>(make_unique<LineBuilder>()); });
+        registry.registerFigure("VerifyFigure" + to_string(i), [](const string& type) { return make_shared<BWFigure>(type); });
+    }
+    done = true;
+    reader.join();
+    // Quiet now, so this registration frees whatever the reader still pinned
+    registry.registerFigure("VerifyQuiet", [](const string& type) { return make_shared<BWFigure>(type); });
+    ok &= expect(wrong == 0, "lookup answered wrong during registration");
+    ok &= expect(registry.graphSlot("VerifyGraph199") > line && registry.makeBuilder(registry.graphSlot("VerifyGraph7")),
+                 "registered graph type missing");
+    ok &= expect(token.use_count() == 2, "superseded tables kept: " + to_string(token.use_count() - 1) + " alive");
+
+    FlyweightFactory flyweights;
+    ok &= expect(dynamic_pointer_cast<BWFigure>(flyweights.getFigure("VerifyColorBW")) != nullptr,
+                 "registered figure lost to the naming rule");
+    ok &= expect(dynamic_pointer_cast<ColoredFigure>(flyweights.getFigure("VerifyUnknownColor")) != nullptr,
+                 "unregistered Color name not colored");
+    ok &= expect(dynamic_pointer_cast<BWFigure>(flyweights.getFigure("VerifyUnknown")) != nullptr,
+                 "unregistered plain name not black and white");
+    return ok;
+}
+
+// Repeats a case until it has run for at least minNs, so tiny scales are still measurable
+BenchResult measure(const BenchCase& c, size_t scale, double minNs) {
+    BenchResult r{c.name + "/" + to_string(scale), scale, 0, 0, 0};
+    do {
+        BenchTimer timer;
+        r.operations += c.run(scale, timer);
+        r.totalNs += timer.ns();
+        ++r.iterations;
+    } while (r.totalNs < minNs && r.iterations < 1000000);
+    return r;
+}
+
+void report(const vector<BenchResult>& results, const string& format) {
+    if (format == "json") {
+        // Same shape as Google Benchmark's JSON so existing compare tooling can read it
+        cout << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto& r = results[i];
+            cout << "    {\"name\": \"" << r.name << "\", \"scale\": " << r.scale
+                 << ", \"iterations\": " << r.iterations << ", \"operations\": " << r.operations
+                 << ", \"real_time\": " << r.nsPerOp() << ", \"time_unit\": \"ns\"}"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        cout << "  ]\n}\n";
+    } else if (format == "csv") {
+        cout << "name,scale,iterations,operations,ns_per_op\n";
+        for (auto& r : results)
+            cout << r.name << "," << r.scale << "," << r.iterations << "," << r.operations << "," << r.nsPerOp() << "\n";
+    } else {
+        printf("%-32s %12s %12s\n", "Benchmark", "Iterations", "ns/op");
+        for (auto& r : results) printf("%-32s %12zu %12.1f\n", r.name.c_str(), r.iterations, r.nsPerOp());
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t maxScale = 100000;
+    double minMs = 100;
+    string format = "console", filter;
+    bool verify = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--max-scale=", 0) == 0) maxScale = stoull(arg.substr(12));
+        else if (arg.rfind("--min-time-ms=", 0) == 0) minMs = stod(arg.substr(14));
+        else if (arg.rfind("--format=", 0) == 0) format = arg.substr(9);
+        else if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg == "--verify") verify = true;
+        else {
+            cerr << "usage: bench [--max-scale=N (up to 10000000)] [--min-time-ms=T] "
+                    "[--format=console|json|csv] [--filter=substring] [--verify]\n";
+            return 1;
+        }
+    }
+
+    // Stub output is discarded so the numbers measure the engine, not the terminal
+    Output::getInstance().setSink(make_shared<NullSink>());
+
+    if (verify) {
+        vector<VerifyCase> checks = {
+            {"Journal_recoverCommands", [] { return verifyRecovery(HistoryMode::Commands, "diagram_verify_commands"); }},
+            {"Journal_recoverVersions", [] { return verifyRecovery(HistoryMode::Versions, "diagram_verify_versions"); }},
+            {"Journal_undoAcrossCheckpointCommands",
+             [] { return verifyUndoAcrossCheckpoint(HistoryMode::Commands, "diagram_verify_undo_commands"); }},
+            {"Journal_undoAcrossCheckpointVersions",
+             [] { return verifyUndoAcrossCheckpoint(HistoryMode::Versions, "diagram_verify_undo_versions"); }},
+            {"SceneFile_roundTrip", verifySceneFile},
+            {"Collab_convergence", verifyCollabConvergence},
+            {"Collab_causalGap", verifyCollabCausalGap},
+            {"Kernels_aggregate", verifyAggregate},
+            {"Kernels_histogramSplatArea", verifyDataKernels},
+            {"LineBuilder_liveStream", verifyLiveStream},
+            {"Executor_parallelForThrow", verifyParallelForThrow},
+            {"Registry_lookup", verifyRegistryLookup},
+            {"Async_throw", verifyAsyncThrow},
+            {"Scene_extremeBounds", verifySceneExtremeBounds},
+            {"Scene_snapshotUnchanged", verifySnapshotUnchanged},
+        };
+        int failed = 0;
+        for (auto& c : checks) {
+            if (!filter.empty() && c.name.find(filter) == string::npos) continue;
+            bool ok = c.run();
+            printf("%-40s %s\n", c.name.c_str(), ok ? "ok" : "FAILED");
+            failed += !ok;
+        }
+        return failed ? 1 : 0;
+    }
+
+    vector<BenchCase> cases = {
+        {"DiagramFactory_getDiagram", benchGetDiagram},
+        {"FlyweightFactory_getFigure_hit", benchFlyweightHit},
+        {"FlyweightFactory_getFigure_miss", benchFlyweightMiss},
+        {"Director_construct", benchDirectorConstruct},
+        {"StaticDirector_construct", benchStaticDirectorConstruct},
+        {"Registry_lookup", benchRegistryLookup},
+        {"Observer_fanOut", benchObserverFanOut},
+        {"DiagramFactory_undoRedo", benchUndoRedo},
+        {"DiagramFactory_undoRedoVersions", benchUndoRedoVersions},
+        {"DiagramFactory_versionJump", benchVersionJump},
+        {"DiagramFactory_denseCellsVersions", benchDenseCellsVersions},
+        {"GraphFactory_createGraphAsync", benchCreateGraphAsync},
+        {"ExportVisitor_exportAsync", benchExportAsync},
+        {"Session_editAsync", benchSessionEdits},
+        {"Scene_snapshotEdit", benchSnapshotEdit},
+        {"Collab_merge", benchCollabMerge},
+        {"HistogramBuilder_construct", benchHistogram},
+        {"ScatterBuilder_construct", benchScatter},
+        {"BarBuilder_aggregate", benchBarAggregate},
+        {"LineBuilder_stream", benchLineStream},
+    };
+    vector<BenchResult> results;
+    for (auto& c : cases) {
+        if (!filter.empty() && c.name.find(filter) == string::npos) continue;
+        for (size_t scale = 1; scale <= maxScale && scale <= 10000000; scale *= 10)
+            results.push_back(measure(c, scale, minMs * 1e6));
+    }
+    report(results, format);
+    return 0;
+}
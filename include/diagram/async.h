@@ -0,0 +1,236 @@
+// Coroutine support: lazily started tasks that run on the shared Executor, and helpers
+// to await many tasks or block on one from synchronous code.
+#ifndef DIAGRAM_ASYNC_H
+#define DIAGRAM_ASYNC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "diagram/executor.h"
+
+namespace diagram {
+
+template <typename T> class Task;
+
+namespace detail {
+
+// Resumes whoever awaited the task once it finishes (symmetric transfer, no stack growth)
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+        auto next = h.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    // Kept for whoever awaits the task, e.g. a kernel's parallelFor rethrowing a chunk's failure
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+    void rethrowIfFailed() const {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result() {
+        rethrowIfFailed();
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() const noexcept {}
+    void result() const { rethrowIfFailed(); }
+};
+
+// Fire-and-forget coroutine that frees itself on completion; used to drive tasks from outside
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        // Its bodies below catch what the awaited task throws, so nothing should get here
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+// Async - Lazily started coroutine producing a T; starts when first awaited
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+template <typename T>
+struct SyncState {
+    std::mutex lock;
+    std::condition_variable finished;
+    bool done = false;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+    std::exception_ptr error;
+};
+
+template <typename T>
+Detached runToCompletion(Task<T> task, SyncState<T>* state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            state->value.emplace(true);
+        } else {
+            state->value.emplace(co_await task);
+        }
+    } catch (...) {
+        state->error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->done = true;
+    state->finished.notify_one();
+}
+
+// The first task to fail is reported once every task has finished
+struct WhenAllBase {
+    std::atomic<size_t> remaining;
+    std::coroutine_handle<> waiter;
+    std::mutex errorLock;
+    std::exception_ptr error;
+    explicit WhenAllBase(size_t n) : remaining(n + 1) {}
+    void arrive() {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) waiter.resume();
+    }
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if (!error) error = std::move(e);
+    }
+};
+
+template <typename T>
+struct WhenAllState : WhenAllBase {
+    std::vector<std::optional<T>> results;
+    explicit WhenAllState(size_t n) : WhenAllBase(n), results(n) {}
+};
+
+template <>
+struct WhenAllState<void> : WhenAllBase {
+    using WhenAllBase::WhenAllBase;
+};
+
+template <typename T>
+Detached runOne(Task<T> task, WhenAllState<T>* state, size_t slot) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            (void)slot;
+        } else {
+            state->results[slot].emplace(co_await task);
+        }
+    } catch (...) {
+        state->fail(std::current_exception());
+    }
+    state->arrive();
+}
+
+} // namespace detail
+
+// Blocks the calling (non-pool) thread until the task finishes and returns its result, or
+// rethrows what the task threw
+template <typename T>
+T syncWait(Task<T> task) {
+    detail::SyncState<T> state;
+    detail::runToCompletion(std::move(task), &state);
+    std::unique_lock<std::mutex> guard(state.lock);
+    state.finished.wait(guard, [&] { return state.done; });
+    if (state.error) std::rethrow_exception(state.error);
+    if constexpr (!std::is_void_v<T>) return std::move(*state.value);
+}
+
+// Starts every task at once and resumes the caller when the last finishes; results keep input
+// order. If any task threw, awaiting rethrows the first failure instead
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> whenAll(std::vector<Task<T>> tasks) {
+    detail::WhenAllState<T> state(tasks.size());
+    struct Awaiter {
+        detail::WhenAllState<T>* state;
+        std::vector<Task<T>>* tasks;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            state->waiter = h;
+            for (size_t i = 0; i < tasks->size(); ++i) detail::runOne(std::move((*tasks)[i]), state, i);
+            // Our own reference: if every task already finished, continue without suspending
+            return state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+        void await_resume() const noexcept {}
+    };
+    co_await Awaiter{&state, &tasks};
+    if (state.error) std::rethrow_exception(state.error);
+    if constexpr (!std::is_void_v<T>) {
+        std::vector<T> results;
+        results.reserve(state.results.size());
+        for (auto& r : state.results) results.push_back(std::move(*r));
+        co_return results;
+    }
+}
+
+} // namespace diagram
+
+#endif // DIAGRAM_ASYNC_H
@@ -0,0 +1,217 @@
+// Graph construction: builders, the director that sequences them and the graph factory.
+#ifndef DIAGRAM_BUILDER_H
+#define DIAGRAM_BUILDER_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "diagram/async.h"
+#include "diagram/elements.h"
+#include "diagram/export.h"
+#include "diagram/instrumentation.h"
+#include "diagram/kernels.h"
+#include "diagram/scene.h"
+#include "diagram/stream.h"
+
+namespace diagram {
+
+// Builder Pattern - Interface
+class DIAGRAM_API Builder {
+public:
+    virtual void setCoord(std::string coord) = 0;
+    // Data-driven builders read it in calc(); the others ignore it
+    virtual void setData(const GraphData&) {}
+    virtual void calc() = 0;
+    virtual void draw() = 0;
+    virtual void drag() = 0;
+    virtual ~Builder() = default;
+};
+
+// Builder Pattern - Concrete Builder; holds per-construction state, so each GraphFactory owns one.
+// Given raw rows (data.keys) it aggregates them into one bar per key
+class DIAGRAM_API BarBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    GraphData data;
+    GroupedValues bars;
+public:
+    // Process-wide instance, for callers driving a Director directly
+    static BarBuilder& getInstance();
+    void setCoord(std::string c) override { coord = c; }
+    void setData(const GraphData& d) override { data = d; }
+    void calc() override;
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Bar at " << coord << "\n"; }
+    const GroupedValues& result() const { return bars; }
+};
+
+// Builder Pattern - Concrete Builder; holds per-construction state, so each GraphFactory owns one.
+// In streaming mode a producer thread appends to stream() and each refresh() redraws only the
+// points scrolled in since the last one, instead of a full construction per update
+class DIAGRAM_API LineBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    std::unique_ptr<LiveSeries> live;
+public:
+    // Process-wide instance, for callers driving a Director directly
+    static LineBuilder& getInstance();
+    void setCoord(std::string c) override { coord = c; }
+    void calc() override { out() << "Line calc at " << coord << "\n"; }
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Line at " << coord << "\n"; }
+
+    // Starts (or restarts, dropping any points) a stream showing the last `window` points
+    void startStream(std::size_t capacity, std::size_t window);
+    // nullptr until startStream
+    LiveSeries* stream() { return live.get(); }
+    // Drawing thread only; an empty update when not streaming
+    StreamUpdate refresh();
+};
+
+// Builder Pattern - Concrete Builder; points are density-splatted, so millions of them cost
+// one grid to draw instead of one marker each
+class DIAGRAM_API ScatterBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    GraphData data;
+    DensityGrid density;
+public:
+    static constexpr int kGridSize = 256;
+    void setCoord(std::string c) override { coord = c; }
+    void setData(const GraphData& d) override { data = d; }
+    void calc() override;
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Scatter at " << coord << "\n"; }
+    const DensityGrid& result() const { return density; }
+};
+
+// Builder Pattern - Concrete Builder; integrates the area under the line and keeps its
+// envelope per drawn column
+class DIAGRAM_API AreaBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    GraphData data;
+    AreaProfile profile;
+public:
+    static constexpr int kColumns = 512;
+    void setCoord(std::string c) override { coord = c; }
+    void setData(const GraphData& d) override { data = d; }
+    void calc() override;
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Area at " << coord << "\n"; }
+    const AreaProfile& result() const { return profile; }
+};
+
+// Builder Pattern - Concrete Builder; bins the x values
+class DIAGRAM_API HistogramBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    GraphData data;
+    Histogram bins;
+public:
+    static constexpr size_t kBins = 64;
+    void setCoord(std::string c) override { coord = c; }
+    void setData(const GraphData& d) override { data = d; }
+    void calc() override;
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Histogram at " << coord << "\n"; }
+    const Histogram& result() const { return bins; }
+};
+
+// Builder Pattern - Concrete Builder; sums point weights (or counts points) per grid cell
+class DIAGRAM_API HeatmapBuilder final : public Builder {
+    std::string coord;
+    DrawGraph proxy;
+    GraphData data;
+    DensityGrid heat;
+public:
+    static constexpr int kGridSize = 64;
+    void setCoord(std::string c) override { coord = c; }
+    void setData(const GraphData& d) override { data = d; }
+    void calc() override;
+    void draw() override { proxy.draw(); }
+    void drag() override { out() << "Drag Heatmap at " << coord << "\n"; }
+    const DensityGrid& result() const { return heat; }
+};
+
+// Builder Pattern - Director
+class DIAGRAM_API Director {
+    Builder* builder;
+public:
+    void setBuilder(Builder* b) { builder = b; }
+    void construct(std::string type, std::string coord);
+};
+
+// Draw backend for StaticDirector - the builder's own draw proxy, as the dynamic Director uses
+struct ProxyBackend {
+    template <typename Stages>
+    void draw(Stages& stages, const std::string&) { stages.draw(); }
+};
+
+// Styling for CanvasBackend: marker edge in pixels and its shade
+template <int Size = 8, unsigned char Shade = 255>
+struct MarkerStyle {
+    static constexpr int size = Size;
+    static constexpr unsigned char shade = Shade;
+};
+
+// Draw backend for StaticDirector - marks the graph's anchor (coord in canvas pixels) on a canvas
+template <typename Style = MarkerStyle<>>
+class CanvasBackend {
+    Canvas* target;
+public:
+    explicit CanvasBackend(Canvas& canvas) : target(&canvas) {}
+    template <typename Stages>
+    void draw(Stages&, const std::string& coord) {
+        Point p = parseCoord(coord);
+        target->fillRect((int)p.x - Style::size / 2, (int)p.y - Style::size / 2, Style::size, Style::size, Style::shade);
+    }
+};
+
+// Builder Pattern - Director bound at compile time for fixed chart types, e.g.
+// StaticDirector<BarBuilder, CanvasBackend<MarkerStyle<4>>>. It owns the (final) builder and the
+// backend by value, so every stage is a direct call the compiler can inline and fuse; only the
+// whole construction is timed. Director stays the dynamic path for types chosen at runtime
+template <typename Stages, typename Backend = ProxyBackend>
+class StaticDirector {
+    Stages stages;
+    Backend backend;
+public:
+    StaticDirector() = default;
+    explicit StaticDirector(Backend b) : backend(std::move(b)) {}
+    Stages& builder() { return stages; }
+    void construct(const std::string& coord) {
+        DIAGRAM_TIME_STAGE(StageConstruct);
+        stages.setCoord(coord);
+        stages.calc();
+        backend.draw(stages, coord);
+        stages.drag();
+    }
+};
+
+// Factory Pattern - For creating Graphs; safe to call from any thread. Each factory has its
+// own builders, so constructions in different factories (documents) never contend
+class DIAGRAM_API GraphFactory {
+    std::mutex constructLock;
+    std::vector<std::unique_ptr<Builder>> builders;  // by TypeRegistry graph slot, made on first use
+
+    Builder* ownedBuilder(int slot);  // constructLock held
+public:
+    // Any type in the TypeRegistry (built in: Bar, Line, Scatter, Area, Histogram, Heatmap);
+    // false for any other type
+    bool createGraph(std::string type, std::string coord, const GraphData& data = {});
+    // Runs createGraph on the shared Executor; the factory must outlive the task
+    Task<bool> createGraphAsync(std::string type, std::string coord);
+    // This factory's builder for a type (made on first use), e.g. to start a stream on its
+    // LineBuilder; nullptr for unknown types. The builder lives as long as the factory, and
+    // calls on it are not serialized with constructions
+    Builder* builder(const std::string& type);
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_BUILDER_H
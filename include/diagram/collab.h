@@ -0,0 +1,79 @@
+// Collaborative editing: an operation-based CRDT over a document. Each client runs a Replica;
+// replicas exchange compact op batches and converge whatever order the batches arrive in.
+#ifndef DIAGRAM_COLLAB_H
+#define DIAGRAM_COLLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "diagram/diagram_factory.h"
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Collaboration - Globally unique op id: the issuing replica and its per-replica sequence number.
+// A create's id also names the element it creates, on every replica
+struct OpId {
+    std::uint32_t replica = 0;
+    std::uint64_t seq = 0;
+    bool operator==(const OpId& o) const { return replica == o.replica && seq == o.seq; }
+    bool operator<(const OpId& o) const { return replica != o.replica ? replica < o.replica : seq < o.seq; }
+};
+
+enum class OpKind : std::uint8_t { Create = 1, Move = 2, Remove = 3 };
+
+// Collaboration - One edit. Creates are unique, moves are last-writer-wins by (lamport, replica)
+// and removes win over concurrent moves
+struct Operation {
+    OpKind kind = OpKind::Create;
+    OpId id;
+    std::uint64_t lamport = 0;
+    OpId target;                       // Move / Remove: the element's create op
+    std::string element, type, coord;  // Create: all three; Move: coord
+};
+
+// Wire form of a batch: varint counts, a per-batch string table and delta-coded ids and clocks,
+// so a run of local edits costs a few bytes per op
+DIAGRAM_API std::string encodeOps(const std::vector<Operation>& ops);
+// False if the batch is truncated or malformed; ops is then left unspecified
+DIAGRAM_API bool decodeOps(const std::string& batch, std::vector<Operation>& ops);
+
+// Collaboration - A client's view of a shared document. Ops are delivered causally: each
+// replica's ops in sequence order, and moves/removes only after the create they target.
+// Edits made through a replica, local or remote, change the document's scene directly: they
+// are not journaled and stay out of its undo history. Not thread-safe; one replica per client
+class DIAGRAM_API Replica {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+public:
+    // Replica ids must be unique among the clients of one document
+    Replica(std::uint32_t id, DiagramFactory& document);
+    Replica(const Replica&) = delete;
+    Replica& operator=(const Replica&) = delete;
+    ~Replica();
+
+    // Local edits apply at once and are queued for broadcast; false for unknown or removed elements
+    OpId create(std::string element, std::string type, std::string coord);
+    bool move(OpId element, std::string coord);
+    bool remove(OpId element);
+
+    // Local ops since the last call, as one encoded batch (empty if there are none)
+    std::string takeOutgoing();
+    // Applies a remote batch in causal order; ops that arrive early wait for their dependencies
+    // and duplicates are ignored. Returns the number of ops applied, or -1 for a malformed batch
+    long merge(const std::string& batch);
+    // Ops received but still waiting for a dependency
+    std::size_t pending() const;
+
+    // Scene id of an element on this replica, or -1 if it is unknown or removed
+    int sceneId(OpId element) const;
+    // Order-independent hash of the live elements; equal on replicas that have seen the same ops
+    std::uint64_t stateHash() const;
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_COLLAB_H
@@ -0,0 +1,133 @@
+// Undoable commands and the undo/redo stacks DiagramFactory keeps them on.
+#ifndef DIAGRAM_COMMAND_H
+#define DIAGRAM_COMMAND_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include "diagram/builder.h"
+#include "diagram/export.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+// Command Pattern - Abstract Command
+class DIAGRAM_API Command {
+public:
+    virtual void execute() = 0;
+    virtual void undo() = 0;
+    virtual ~Command() = default;
+};
+
+// Command Pattern - Concrete Command
+class DIAGRAM_API CreateGraphCommand : public Command {
+    std::string type, coord;
+    GraphFactory* factory;
+    Scene* scene;
+    int elementId = -1;
+public:
+    CreateGraphCommand(GraphFactory* f, Scene* s, std::string t, std::string c, int id = -1)
+        : type(t), coord(c), factory(f), scene(s), elementId(id) {}
+    void execute() override {
+        if (factory->createGraph(type, coord))
+            elementId = scene->add("Graph", type, coord, std::make_shared<Graph>());
+    }
+    void undo() override {
+        out() << "Undo creation of graph: " << type << "\n";
+        scene->remove(elementId);
+        elementId = -1;
+    }
+    int element() const { return elementId; }
+    const std::string& graphType() const { return type; }
+    const std::string& graphCoord() const { return coord; }
+};
+
+// Command Pattern - Undo Manager
+class Undo {
+    std::stack<std::shared_ptr<Command>> undoStack;
+public:
+    void addCommand(std::shared_ptr<Command> cmd) {
+        undoStack.push(cmd);
+    }
+    std::shared_ptr<Command> popCommand() {
+        if (undoStack.empty()) return nullptr;
+        auto cmd = undoStack.top();
+        undoStack.pop();
+        return cmd;
+    }
+    bool empty() const { return undoStack.empty(); }
+    // Bottom-to-top copy of the stack
+    std::vector<std::shared_ptr<Command>> contents() const {
+        std::vector<std::shared_ptr<Command>> cmds;
+        for (auto copy = undoStack; !copy.empty(); copy.pop()) cmds.push_back(copy.top());
+        std::reverse(cmds.begin(), cmds.end());
+        return cmds;
+    }
+};
+
+// Command Pattern - Redo Manager
+class Redo {
+    std::stack<std::shared_ptr<Command>> redoStack;
+public:
+    void addCommand(std::shared_ptr<Command> cmd) {
+        redoStack.push(cmd);
+    }
+    std::shared_ptr<Command> popCommand() {
+        if (redoStack.empty()) return nullptr;
+        auto cmd = redoStack.top();
+        redoStack.pop();
+        return cmd;
+    }
+    bool empty() const { return redoStack.empty(); }
+    void clear() {
+        while (!redoStack.empty()) redoStack.pop();
+    }
+    // Bottom-to-top copy of the stack
+    std::vector<std::shared_ptr<Command>> contents() const {
+        std::vector<std::shared_ptr<Command>> cmds;
+        for (auto copy = redoStack; !copy.empty(); copy.pop()) cmds.push_back(copy.top());
+        std::reverse(cmds.begin(), cmds.end());
+        return cmds;
+    }
+};
+
+// Persistent History - Timeline of scene versions; undo/redo move a cursor and restore the
+// version under it, so a jump of any distance is a single O(1) restore
+class VersionHistory {
+    std::vector<SceneSnapshot> versions;
+    size_t cursor = 0;
+public:
+    void reset(SceneSnapshot initial) {
+        versions.clear();
+        versions.push_back(std::move(initial));
+        cursor = 0;
+    }
+    // Records the version after an edit; versions that could have been redone are dropped
+    void record(SceneSnapshot version) {
+        versions.erase(versions.begin() + (std::ptrdiff_t)(cursor + 1), versions.end());
+        versions.push_back(std::move(version));
+        cursor = versions.size() - 1;
+    }
+    // Both return how many steps were actually taken
+    size_t undo(size_t steps) {
+        steps = std::min(steps, cursor);
+        cursor -= steps;
+        return steps;
+    }
+    size_t redo(size_t steps) {
+        steps = std::min(steps, versions.size() - 1 - cursor);
+        cursor += steps;
+        return steps;
+    }
+    const SceneSnapshot& current() const { return versions[cursor]; }
+    // Versions recorded, the initial one included
+    size_t size() const { return versions.size(); }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_COMMAND_H
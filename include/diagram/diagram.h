@@ -0,0 +1,24 @@
+// Diagram engine umbrella header: factories, builders, flyweights, scene, rendering,
+// persistence, sessions, collaboration and instrumentation. Link against diagram::diagram.
+#ifndef DIAGRAM_DIAGRAM_H
+#define DIAGRAM_DIAGRAM_H
+
+#include "diagram/async.h"
+#include "diagram/builder.h"
+#include "diagram/collab.h"
+#include "diagram/command.h"
+#include "diagram/diagram_factory.h"
+#include "diagram/elements.h"
+#include "diagram/export.h"
+#include "diagram/flyweight.h"
+#include "diagram/instrumentation.h"
+#include "diagram/journal.h"
+#include "diagram/kernels.h"
+#include "diagram/output.h"
+#include "diagram/registry.h"
+#include "diagram/scene.h"
+#include "diagram/scene_file.h"
+#include "diagram/session.h"
+#include "diagram/stream.h"
+
+#endif // DIAGRAM_DIAGRAM_H
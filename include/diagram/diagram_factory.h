@@ -0,0 +1,67 @@
+// DiagramFactory - the engine's entry point. State lives behind a private implementation
+// so the class layout, and with it the library ABI, does not change as internals evolve.
+#ifndef DIAGRAM_DIAGRAM_FACTORY_H
+#define DIAGRAM_DIAGRAM_FACTORY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "diagram/export.h"
+#include "diagram/journal.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+// How undo/redo work: Commands reverses and re-executes recorded commands (re-running graph
+// construction on redo); Versions restores persistent scene versions, so every creation is
+// undoable and a jump of any distance is one O(1) swap with nothing re-constructed
+enum class HistoryMode { Commands, Versions };
+
+// High-level Factory - Coordinates command execution, undo/redo, and observers
+class DIAGRAM_API DiagramFactory {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+public:
+    DiagramFactory();
+    DiagramFactory(const DiagramFactory&) = delete;
+    DiagramFactory& operator=(const DiagramFactory&) = delete;
+    ~DiagramFactory();
+
+    // Each creation returns the new element's scene id, or -1 if nothing was created.
+    // There is deliberately no GraphData overload: redo and journal replay rebuild a graph from
+    // its type and coord alone, and borrowed data pointers cannot be recorded. Data-driven graphs
+    // are built with GraphFactory::createGraph directly
+    int createGraph(std::string type, std::string coord);
+    int createFigure(std::string type, std::string coord);
+    int getDiagram(std::string element, std::string type, std::string coord);
+    // Switching modes clears the history; set it before enableJournal so replay uses the same mode
+    void setHistoryMode(HistoryMode mode);
+    HistoryMode historyMode() const;
+    // In Versions mode the whole scene is restored, including direct Scene edits made since
+    void undo(size_t steps = 1);
+    void redo(size_t steps = 1);
+    Scene& getScene();
+    Viewport& viewport() { return getScene().viewport(); }
+    void render() { getScene().render(); }
+
+    bool save(const std::string& path);
+    // Appends a saved scene's elements to this one, keeping their ids where free; builders are not re-run
+    bool load(const std::string& path);
+
+    // Crash recovery - loads the last snapshot, replays the journal on top of it (with output
+    // silenced on the calling thread only), then keeps appending every command. Only for a
+    // fresh document: false, with nothing changed, if the journal is already enabled or the
+    // scene or its undo history is not empty
+    bool enableJournal(const std::string& journalFile, const std::string& snapshotFile, JournalOptions options = {});
+    // Group-commits buffered journal records now, regardless of batch size
+    bool flushJournal();
+    // Snapshot then truncate; the snapshot is renamed into place so a crash leaves the old one intact.
+    // Commands-mode history survives a checkpoint; in Versions mode the snapshot becomes the
+    // oldest version, so undo stops there both live and after recovery
+    bool checkpoint();
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_DIAGRAM_FACTORY_H
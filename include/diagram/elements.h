@@ -0,0 +1,137 @@
+// Diagram elements: graphs and figures, their subscribers, visitors and the draw proxy.
+#ifndef DIAGRAM_ELEMENTS_H
+#define DIAGRAM_ELEMENTS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "diagram/async.h"
+#include "diagram/export.h"
+#include "diagram/output.h"
+
+namespace diagram {
+
+// Observer Pattern - Interface. Subscribers are notified in attach order, on the drawing
+// thread, until an element has 256 of them; beyond that notify() is fanned out over the
+// Executor and runs concurrently and in no particular order, so it must be thread-safe
+class DIAGRAM_API DrawSubscriber {
+public:
+    virtual void notify(const std::string& message) = 0;
+    virtual ~DrawSubscriber() = default;
+};
+
+// Observer Pattern - Concrete Observers
+class DIAGRAM_API RegSub : public DrawSubscriber {
+public:
+    void notify(const std::string& message) override {
+        out() << "[Regular Subscriber] " << message << "\n";
+    }
+};
+
+class DIAGRAM_API ContrastImageSub : public DrawSubscriber {
+public:
+    void notify(const std::string& message) override {
+        out() << "[Contrast Image Subscriber] " << message << "\n";
+    }
+};
+
+class DiagramVisitor;
+
+// Base class for all Diagrams (Graphs and Figures)
+class DIAGRAM_API Diagram {
+public:
+    virtual void calc() = 0;
+    virtual void draw() = 0;
+    virtual void drag() = 0;
+    // See DrawSubscriber for when notify() may run concurrently
+    virtual void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) = 0;
+    virtual void accept(DiagramVisitor* visitor) = 0;
+    virtual ~Diagram() = default;
+};
+
+// Visitor Pattern - Interface
+class DIAGRAM_API DiagramVisitor {
+public:
+    virtual void visit(class Graph* g) = 0;
+    virtual void visit(class Figure* f) = 0;
+    virtual ~DiagramVisitor() = default;
+};
+
+// Visitor Pattern - Concrete Visitors for Exporting
+class DIAGRAM_API ExportVisitor : public DiagramVisitor {
+public:
+    void visit(Graph* g) override;
+    void visit(Figure* f) override;
+    // Exports on the shared Executor; the visitor must outlive the task, the diagram is kept alive by it
+    Task<> exportAsync(std::shared_ptr<Diagram> diagram);
+};
+
+// Subject in Observer Pattern, Concrete Element in Visitor Pattern
+class DIAGRAM_API Graph : public Diagram {
+    std::vector<std::shared_ptr<DrawSubscriber>> subscribers;
+public:
+    void calc() override {
+        out() << "Calculating Graph\n";
+        notifySubscribers("Graph calculated");
+    }
+    void draw() override {
+        out() << "[Graph] Drawing graphical representation.\n";
+        notifySubscribers("Graph drawn");
+    }
+    void drag() override {
+        out() << "Dragging Graph\n";
+        notifySubscribers("Graph dragged");
+    }
+    void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) override {
+        subscribers.push_back(sub);
+    }
+    void accept(DiagramVisitor* visitor) override {
+        visitor->visit(this);
+    }
+private:
+    void notifySubscribers(const std::string& msg);
+};
+
+// Subject in Observer Pattern, Concrete Element in Visitor Pattern
+class DIAGRAM_API Figure : public Diagram {
+    std::vector<std::shared_ptr<DrawSubscriber>> subscribers;
+public:
+    void calc() override {
+        out() << "Calculating Figure\n";
+        notifySubscribers("Figure calculated");
+    }
+    void draw() override {
+        out() << "[Figure Stub] Drawing textual stub.\n";
+        notifySubscribers("Figure drawn");
+    }
+    void drag() override {
+        out() << "Dragging Figure\n";
+        notifySubscribers("Figure dragged");
+    }
+    void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) override {
+        subscribers.push_back(sub);
+    }
+    void accept(DiagramVisitor* visitor) override {
+        visitor->visit(this);
+    }
+private:
+    void notifySubscribers(const std::string& msg);
+};
+
+// Proxy Pattern - Interface
+class DIAGRAM_API DrawProxy {
+public:
+    virtual void draw() = 0;
+    virtual ~DrawProxy() = default;
+};
+
+// Proxy Pattern - Concrete Proxy
+class DIAGRAM_API DrawGraph : public DrawProxy {
+public:
+    void draw() override;
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_ELEMENTS_H
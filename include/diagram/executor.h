@@ -0,0 +1,58 @@
+// Process-wide work-stealing scheduler shared by rendering, export, calc and the server.
+#ifndef DIAGRAM_EXECUTOR_H
+#define DIAGRAM_EXECUTOR_H
+
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Scheduling - Higher priorities are taken first, from a worker's own deque and when stealing
+enum class Priority { High = 0, Normal = 1, Low = 2 };
+constexpr int kPriorityCount = 3;
+
+// Scheduling - One worker per allowed core, each owning a deque per priority. Owners push and
+// pop at the back (LIFO, cache-warm); idle workers steal from the front of other workers'
+// deques, trying workers on their own NUMA node before remote ones. Work submitted from
+// outside the pool is placed on a worker of the submitting thread's node. Workers are pinned
+// to their core only when the machine has more than one node.
+class DIAGRAM_API Executor {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    Executor();
+public:
+    static Executor& getInstance();
+    ~Executor();
+    // The job must not throw: it may run on any worker, or on a thread helping inside
+    // parallelFor, and an escaping exception terminates the process wherever it runs
+    void post(std::function<void()> job, Priority priority = Priority::Normal);
+    size_t threads() const;
+    size_t numaNodes() const;
+
+    // Runs fn(begin, end) over [0, count) in chunks of at least grain and returns when all are
+    // done. The caller runs chunks too, so it is safe (and cheap) to call from a pool thread.
+    // If fn throws, the remaining chunks are skipped and the first exception is rethrown here
+    // once every chunk has finished.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn,
+                     Priority priority = Priority::High);
+
+    // co_await executor.schedule() continues the coroutine on a pool thread
+    auto schedule(Priority priority = Priority::Normal) {
+        struct Awaiter {
+            Executor* executor;
+            Priority priority;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor->post([h] { h.resume(); }, priority); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this, priority};
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_EXECUTOR_H
@@ -0,0 +1,18 @@
+// Symbol visibility for the diagram library. The library is built with hidden visibility;
+// only classes and functions marked DIAGRAM_API form its public interface.
+#ifndef DIAGRAM_EXPORT_H
+#define DIAGRAM_EXPORT_H
+
+#if defined(DIAGRAM_STATIC)
+#define DIAGRAM_API
+#elif defined(_WIN32)
+#ifdef DIAGRAM_BUILDING
+#define DIAGRAM_API __declspec(dllexport)
+#else
+#define DIAGRAM_API __declspec(dllimport)
+#endif
+#else
+#define DIAGRAM_API __attribute__((visibility("default")))
+#endif
+
+#endif // DIAGRAM_EXPORT_H
@@ -0,0 +1,186 @@
+// Shared figure flyweights, their tessellated geometry and the canvas they rasterize into.
+#ifndef DIAGRAM_FLYWEIGHT_H
+#define DIAGRAM_FLYWEIGHT_H
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "diagram/elements.h"
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Raster Target - Grayscale canvas that batched draw passes rasterize into
+class Canvas {
+    int w = 0, h = 0;
+    std::vector<unsigned char> pixels;
+public:
+    Canvas(int width = 0, int height = 0) { reset(width, height); }
+    void reset(int width, int height) {
+        w = width;
+        h = height;
+        pixels.assign((size_t)w * h, 0);
+    }
+    void fillRect(int x, int y, int rw, int rh, unsigned char shade) {
+        int x0 = std::max(x, 0), y0 = std::max(y, 0), x1 = std::min(x + rw, w), y1 = std::min(y + rh, h);
+        for (int row = y0; row < y1; ++row)
+            for (int col = x0; col < x1; ++col) {
+                auto& px = pixels[(size_t)row * w + col];
+                px = std::max(px, shade);
+            }
+    }
+    // Composites a coverage mask, scaling its 0-255 coverage by shade; rows outside
+    // [rowBegin, rowEnd) are left alone so disjoint bands can be filled concurrently
+    void blit(const unsigned char* mask, int size, int x, int y, unsigned char shade,
+              int rowBegin = 0, int rowEnd = INT_MAX) {
+        int x0 = std::max(x, 0), y0 = std::max({y, 0, rowBegin}), x1 = std::min(x + size, w);
+        int y1 = std::min({y + size, h, rowEnd});
+        for (int row = y0; row < y1; ++row) {
+            const unsigned char* src = mask + (size_t)(row - y) * size + (x0 - x);
+            unsigned char* dst = &pixels[(size_t)row * w + x0];
+            for (int col = x0; col < x1; ++col, ++src, ++dst) {
+                unsigned char v = (unsigned char)((*src * shade) / 255);
+                *dst = std::max(*dst, v);
+            }
+        }
+    }
+    int width() const { return w; }
+    int height() const { return h; }
+    const std::vector<unsigned char>& data() const { return pixels; }
+};
+
+// Flyweight Pattern - Intrinsic geometry, tessellated once and shared by every instance of a type
+struct CoverageMask {
+    int size = 0;
+    std::vector<unsigned char> coverage;  // size x size, row-major, 0-255
+};
+
+struct DIAGRAM_API FigureGeometry {
+    static constexpr int kMaskScales[] = {4, 8, 16, 32, 64};
+    std::vector<std::pair<float, float>> outline;  // unit-square space, counter-clockwise
+    std::vector<CoverageMask> masks;               // one per kMaskScales entry
+
+    // Prebuilt mask of exactly the requested on-screen size, or nullptr; other sizes are
+    // rasterized from the outline so the cache never changes what is drawn
+    const CoverageMask* cachedMask(int pixels) const {
+        for (auto& m : masks)
+            if (m.size == pixels) return &m;
+        return nullptr;
+    }
+    CoverageMask maskAt(int pixels) const;
+
+    static FigureGeometry build(const std::string& type);
+    // Process-wide cache; geometry is immutable once built, so every document shares it
+    static std::shared_ptr<const FigureGeometry> shared(const std::string& type);
+};
+
+// Flyweight Pattern - Abstract Flyweight; each factory owns its flyweights (and their
+// subscribers), while the intrinsic geometry behind them is shared process-wide
+class DIAGRAM_API FlyweightFigure {
+    std::once_flag geometryBuilt;
+    std::shared_ptr<const FigureGeometry> cachedGeometry;
+protected:
+    std::string type;
+    // Per-instance cost is a mask blit; the outline is never re-tessellated. Large batches
+    // are split into row bands on the shared Executor.
+    void rasterize(const float* xs, const float* ys, size_t count, int pixelSize, Canvas& canvas, unsigned char shade);
+public:
+    FlyweightFigure(std::string t) : type(t) {}
+    // Resolved on first use, immutable afterwards
+    const FigureGeometry& geometry() {
+        std::call_once(geometryBuilt, [this] { cachedGeometry = FigureGeometry::shared(type); });
+        return *cachedGeometry;
+    }
+    virtual void draw() = 0;
+    // Instanced draw - renders every instance of this flyweight at the given screen positions in one pass
+    virtual void drawBatch(const float* xs, const float* ys, size_t count, int pixelSize, Canvas& canvas) = 0;
+    // See DrawSubscriber for when notify() may run concurrently
+    virtual void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) = 0;
+    virtual ~FlyweightFigure() = default;
+};
+
+// Flyweight Pattern - Concrete Flyweights
+class DIAGRAM_API ColoredFigure : public FlyweightFigure {
+    std::vector<std::weak_ptr<DrawSubscriber>> subscribers;
+    std::mutex subscribersLock;
+public:
+    ColoredFigure(std::string t) : FlyweightFigure(t) {}
+    void draw() override {
+        out() << "[Colored Flyweight] Drawing colored figure of type: " << type << "\n";
+        notifySubscribers("Colored Figure drawn");
+    }
+    void drawBatch(const float* xs, const float* ys, size_t count, int pixelSize, Canvas& canvas) override {
+        out() << "[Colored Flyweight] Drawing " << count << " colored figure(s) of type: " << type << "\n";
+        rasterize(xs, ys, count, pixelSize, canvas, 255);
+        notifySubscribers("Colored Figure batch drawn");
+    }
+    // Shared across threads: attaching is idempotent and notification works on a snapshot.
+    // Held weakly, since the flyweight outlives the factories whose subscribers attach to it.
+    void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) override;
+private:
+    void notifySubscribers(const std::string& msg);
+};
+
+class DIAGRAM_API BWFigure : public FlyweightFigure {
+    std::vector<std::weak_ptr<DrawSubscriber>> subscribers;
+    std::mutex subscribersLock;
+public:
+    BWFigure(std::string t) : FlyweightFigure(t) {}
+    void draw() override {
+        out() << "[B/W Flyweight] Drawing black and white figure of type: " << type << "\n";
+        notifySubscribers("B/W Figure drawn");
+    }
+    void drawBatch(const float* xs, const float* ys, size_t count, int pixelSize, Canvas& canvas) override {
+        out() << "[B/W Flyweight] Drawing " << count << " black and white figure(s) of type: " << type << "\n";
+        rasterize(xs, ys, count, pixelSize, canvas, 128);
+        notifySubscribers("B/W Figure batch drawn");
+    }
+    // Shared across threads: attaching is idempotent and notification works on a snapshot.
+    // Held weakly, since the flyweight outlives the factories whose subscribers attach to it.
+    void attachSubscriber(std::shared_ptr<DrawSubscriber> sub) override;
+private:
+    void notifySubscribers(const std::string& msg);
+};
+
+// Flyweight Pattern - Factory, sharded by type so concurrent lookups rarely share a lock
+class DIAGRAM_API FlyweightFactory {
+    static constexpr size_t kShards = 16;
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<std::string, std::shared_ptr<FlyweightFigure>> pool;
+    };
+    std::array<Shard, kShards> shards;
+public:
+    std::shared_ptr<FlyweightFigure> getFigure(std::string type);
+};
+
+// Factory Pattern - For Figures; one per document, plus a process-wide instance
+class DIAGRAM_API FigureFactory {
+    FlyweightFactory flyFactory;
+    bool threadCached = false;
+    explicit FigureFactory(bool cached) : threadCached(cached) {}
+
+    // The process-wide instance keeps a per-thread cache in front of the sharded pool, so
+    // repeat lookups on a thread take no lock; a document's own factory is uncontended
+    std::shared_ptr<FlyweightFigure> lookup(const std::string& type);
+public:
+    FigureFactory() = default;
+    FigureFactory(const FigureFactory&) = delete;
+    FigureFactory& operator=(const FigureFactory&) = delete;
+    static FigureFactory& getInstance();
+    // Shared flyweight for a type, without the creation-time draw
+    std::shared_ptr<FlyweightFigure> getFlyweight(const std::string& type) { return lookup(type); }
+    std::shared_ptr<FlyweightFigure> getFigure(std::string type, std::string coord, std::shared_ptr<DrawSubscriber> sub);
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_FLYWEIGHT_H
@@ -0,0 +1,151 @@
+// Low-overhead stage timing and Chrome trace export, compiled in with
+// DIAGRAM_INSTRUMENT and DIAGRAM_TRACE respectively.
+#ifndef DIAGRAM_INSTRUMENTATION_H
+#define DIAGRAM_INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Instrumentation - Pipeline stages timed by DIAGRAM_TIME_STAGE
+enum Stage {
+    StageConstruct, StageSetCoord, StageCalc, StageDraw, StageDrag, StageNotify, StageRender,
+    StageServe,  // render server: admission to response written
+    kStageCount
+};
+
+DIAGRAM_API const char* stageName(Stage s);
+
+// Instrumentation - Registry of per-thread latency histograms and the dump API
+class DIAGRAM_API Instrumentation {
+    struct ThreadStages;
+    std::mutex lock;
+    // Kept after a thread exits so its samples still show up in dumps
+    std::vector<std::shared_ptr<ThreadStages>> threads;
+    Instrumentation() = default;
+    ThreadStages& local();
+public:
+    static Instrumentation& getInstance();
+    void record(Stage stage, uint64_t ns);
+    // Histogram buckets for a stage, merged across threads
+    std::vector<uint64_t> merged(Stage stage);
+    // q in [0,1]; result is the containing bucket's lower bound in ns
+    static uint64_t percentile(const std::vector<uint64_t>& buckets, double q);
+    // Table of count and p50/p99/p999 per stage that has samples
+    void dump(std::ostream& os);
+    // Safe while other threads record; a sample recorded during the reset lands on either side
+    void reset();
+};
+
+class ScopedStageTimer {
+    Stage stage;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+public:
+    explicit ScopedStageTimer(Stage s) : stage(s) {}
+    ~ScopedStageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        Instrumentation::getInstance().record(stage, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+// Tracing - Opt-in Chrome trace / Perfetto export. Each thread appends complete ("X")
+// events to its own fixed-size ring; when full the oldest events are overwritten, and
+// because an event carries its begin and duration together, a wrap never leaves an
+// unmatched begin/end pair behind.
+struct TraceEvent {
+    const char* category;
+    const char* name;  // string literals only; stored by pointer
+    uint64_t beginNs, durationNs;
+};
+
+class DIAGRAM_API Tracer {
+    struct ThreadRing;
+    std::atomic<bool> enabled{false};
+    size_t ringCapacity = 1 << 16;
+    std::mutex lock;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    Tracer() = default;
+    ThreadRing& local();
+public:
+    static Tracer& getInstance();
+    // Capacity applies to threads that start tracing afterwards
+    void enable(size_t eventsPerThread = 1 << 16);
+    void disable() { enabled.store(false, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    uint64_t now() const {
+        auto elapsed = std::chrono::steady_clock::now() - epoch;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+    void record(const char* category, const char* name, uint64_t beginNs, uint64_t endNs);
+    // Writes {"traceEvents": [...]} loadable by chrome://tracing and ui.perfetto.dev
+    void dumpChromeJson(std::ostream& os);
+    void clear();
+};
+
+class TraceScope {
+    const char* category;
+    const char* name;
+    uint64_t begin;
+    bool active;
+public:
+    TraceScope(const char* cat, const char* n)
+        : category(cat), name(n), begin(0), active(Tracer::getInstance().isEnabled()) {
+        if (active) begin = Tracer::getInstance().now();
+    }
+    ~TraceScope() {
+        if (active) Tracer::getInstance().record(category, name, begin, Tracer::getInstance().now());
+    }
+};
+
+// Instrumentation - Stage timer and trace scope as one object, so DIAGRAM_TIME_STAGE is a
+// single declaration; either half compiles away when its flag is off
+template <bool Timed, bool Traced>
+class StageScope {
+    struct Off {
+        explicit Off(Stage) {}
+        Off(const char*, const char*) {}
+    };
+    std::conditional_t<Timed, ScopedStageTimer, Off> timer;
+    std::conditional_t<Traced, TraceScope, Off> trace;
+public:
+    explicit StageScope(Stage s) : timer(s), trace("stage", Traced ? stageName(s) : "") {}
+};
+
+} // namespace diagram
+
+// -DDIAGRAM_INSTRUMENT compiles in stage histograms; -DDIAGRAM_TRACE compiles in trace scopes
+// (still off until Tracer::enable()). Stage-timed scopes are traced too. Without the flags
+// both macros expand to nothing.
+#define DIAGRAM_CONCAT_INNER(a, b) a##b
+#define DIAGRAM_CONCAT(a, b) DIAGRAM_CONCAT_INNER(a, b)
+#ifdef DIAGRAM_TRACE
+#define DIAGRAM_TRACE_SCOPE(category, name) ::diagram::TraceScope DIAGRAM_CONCAT(traceScope, __LINE__)(category, name)
+#define DIAGRAM_TRACED_STAGES true
+#else
+#define DIAGRAM_TRACE_SCOPE(category, name) ((void)0)
+#define DIAGRAM_TRACED_STAGES false
+#endif
+#ifdef DIAGRAM_INSTRUMENT
+#define DIAGRAM_TIMED_STAGES true
+#else
+#define DIAGRAM_TIMED_STAGES false
+#endif
+#if defined(DIAGRAM_INSTRUMENT) || defined(DIAGRAM_TRACE)
+#define DIAGRAM_TIME_STAGE(stage)                                                                  \
+    ::diagram::StageScope<DIAGRAM_TIMED_STAGES, DIAGRAM_TRACED_STAGES> DIAGRAM_CONCAT(stageScope, __LINE__)(stage)
+#else
+#define DIAGRAM_TIME_STAGE(stage) ((void)0)
+#endif
+
+#endif // DIAGRAM_INSTRUMENTATION_H
@@ -0,0 +1,20 @@
+// Write-ahead journal settings for DiagramFactory::enableJournal.
+#ifndef DIAGRAM_JOURNAL_H
+#define DIAGRAM_JOURNAL_H
+
+#include <cstddef>
+
+namespace diagram {
+
+// Journal - Append-only write-ahead log of DiagramFactory commands
+enum class FsyncPolicy { Never, EveryBatch, EveryRecord };
+
+struct JournalOptions {
+    FsyncPolicy fsync = FsyncPolicy::EveryBatch;
+    size_t batchSize = 32;            // records buffered per group commit
+    size_t snapshotInterval = 1000;   // committed records between snapshots; 0 disables
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_JOURNAL_H
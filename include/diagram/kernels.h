@@ -0,0 +1,88 @@
+// Data kernels behind the data-driven graph builders: ranges, binning, density splatting and
+// group-by aggregation.
+// Large inputs are split across the shared Executor and reduced from per-chunk partials; the
+// inner loops are branch-free so the compiler vectorizes them (see DIAGRAM_NATIVE / DIAGRAM_ARCH).
+#ifndef DIAGRAM_KERNELS_H
+#define DIAGRAM_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "diagram/export.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+enum class Aggregate { Count, Sum, Mean, Min, Max };
+
+// How raw rows with equal keys combine into one bar; topN > 0 keeps only the largest bars
+struct AggregationSpec {
+    Aggregate fn = Aggregate::Count;
+    std::size_t topN = 0;
+};
+
+// Graph data handed to builders, not owned: x values, optional y values and optional per-point
+// weights. Bar graphs read raw rows instead: a group key per row plus ys as the row values
+// (unused for Count), combined per the aggregation spec. Values must outlive the construction;
+// the range, histogram, splat and area kernels skip NaN and infinite samples
+struct GraphData {
+    const double* xs = nullptr;
+    const double* ys = nullptr;
+    const double* weights = nullptr;
+    std::size_t count = 0;
+    const std::int64_t* keys = nullptr;
+    AggregationSpec aggregation;
+};
+
+struct ValueRange {
+    double min = 0, max = 0;
+};
+
+// Kernels - Min/max of the finite values among n (0/0 when there are none)
+DIAGRAM_API ValueRange valueRange(const double* values, std::size_t n);
+
+// Kernels - Equal-width bins over the data's own range; the maximum lands in the last bin.
+// When every value is equal they all land in the middle bin. Non-finite values are not counted
+struct Histogram {
+    ValueRange range;
+    std::vector<std::uint64_t> counts;
+};
+DIAGRAM_API Histogram histogram(const double* values, std::size_t n, std::size_t bins);
+
+// Kernels - Points splatted onto a width x height grid over their bounding box; each cell holds
+// the point count, or the summed weights when weights are given. Points with a non-finite
+// coordinate are dropped
+struct DensityGrid {
+    Bounds area;
+    int width = 0, height = 0;
+    std::vector<double> cells;  // row-major, row 0 at minY
+    double peak = 0;
+};
+DIAGRAM_API DensityGrid splat(const double* xs, const double* ys, const double* weights, std::size_t n,
+                              int width, int height);
+
+// Kernels - Trapezoid area under a polyline sorted by x, plus its upper envelope sampled into
+// columns for drawing. Segments touching a non-finite point add no area and such points leave
+// the envelope alone
+struct AreaProfile {
+    double area = 0;
+    ValueRange x, y;
+    std::vector<double> envelope;
+};
+DIAGRAM_API AreaProfile areaProfile(const double* xs, const double* ys, std::size_t n, int columns);
+
+// Kernels - Group-by over raw rows. Keys are integers (category codes, years, buckets). Each
+// chunk of rows is aggregated into per-chunk tables split 64 ways by hash, so every table stays
+// cache-sized; the partitions are then merged in parallel, one partition per job, without locks.
+// Groups come back ordered by key, or largest value first when topN is set
+struct GroupedValues {
+    std::vector<std::int64_t> keys;
+    std::vector<double> values;
+};
+DIAGRAM_API GroupedValues aggregate(const std::int64_t* keys, const double* values, std::size_t n,
+                                    const AggregationSpec& spec);
+
+} // namespace diagram
+
+#endif // DIAGRAM_KERNELS_H
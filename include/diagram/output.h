@@ -0,0 +1,118 @@
+// Pluggable output for every textual stub, calc and notification line the engine emits.
+#ifndef DIAGRAM_OUTPUT_H
+#define DIAGRAM_OUTPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Output Sink - Destination for every textual stub, calc and notification line
+class DIAGRAM_API OutputSink {
+public:
+    virtual void write(const char* data, size_t size) = 0;
+    virtual void flush() {}
+    // Lets writers skip formatting entirely when nothing will be kept
+    virtual bool discards() const { return false; }
+    virtual ~OutputSink() = default;
+};
+
+class DIAGRAM_API StreamSink : public OutputSink {
+    std::ostream& stream;
+    std::mutex lock;
+public:
+    explicit StreamSink(std::ostream& os) : stream(os) {}
+    void write(const char* data, size_t size) override;
+    void flush() override;
+};
+
+// Benchmarking sink - measures stub throughput without any I/O
+class DIAGRAM_API NullSink : public OutputSink {
+public:
+    void write(const char*, size_t) override {}
+    bool discards() const override { return true; }
+};
+
+// Output - Singleton holding the active sink (stdout unless replaced)
+class DIAGRAM_API Output {
+    std::shared_ptr<OutputSink> active;
+    mutable std::mutex lock;
+    std::atomic<unsigned> generation{0};
+    Output();
+public:
+    static Output& getInstance();
+    std::shared_ptr<OutputSink> sink() const;
+    // Bumped on every setSink so writers can cache sink properties without locking
+    unsigned version() const { return generation.load(std::memory_order_acquire); }
+    void setSink(std::shared_ptr<OutputSink> s);
+};
+
+// Per-thread buffered writer - formats into a local block and hands whole lines to the
+// sink once the block is large, so no call site pays for a terminal flush
+class DIAGRAM_API OutputBuffer {
+    static constexpr size_t kBlockSize = 64 * 1024;
+    std::string buffer;
+
+    void append(const char* data, size_t size) {
+        buffer.append(data, size);
+        if (buffer.size() >= kBlockSize) flushLines();
+    }
+    void flushLines();
+public:
+    OutputBuffer() { buffer.reserve(kBlockSize); }
+    ~OutputBuffer() { flush(); }
+    void flush();
+    OutputBuffer& operator<<(const std::string& v) { append(v.data(), v.size()); return *this; }
+    OutputBuffer& operator<<(const char* v) { append(v, std::strlen(v)); return *this; }
+    OutputBuffer& operator<<(char v) { append(&v, 1); return *this; }
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    OutputBuffer& operator<<(T v) {
+        char text[32];
+        int n = std::is_floating_point<T>::value ? std::snprintf(text, sizeof text, "%g", (double)v)
+              : std::is_signed<T>::value         ? std::snprintf(text, sizeof text, "%lld", (long long)v)
+                                                 : std::snprintf(text, sizeof text, "%llu", (unsigned long long)v);
+        append(text, (size_t)n);
+        return *this;
+    }
+};
+
+// Sink-aware writer handed to call sites; discarding sinks short-circuit formatting
+class OutputWriter {
+    OutputBuffer* buffer;
+public:
+    explicit OutputWriter(OutputBuffer* b) : buffer(b) {}
+    template <typename T>
+    OutputWriter& operator<<(const T& v) {
+        if (buffer) *buffer << v;
+        return *this;
+    }
+};
+
+// Writer over the calling thread's buffer
+DIAGRAM_API OutputWriter out();
+
+// Flushes the calling thread's buffered output through the active sink
+DIAGRAM_API void flushOutput();
+
+// Scoped silence for the calling thread only (e.g. journal replay); other threads and the
+// active sink are untouched. Scopes nest
+class DIAGRAM_API QuietOutput {
+public:
+    QuietOutput();
+    ~QuietOutput();
+    QuietOutput(const QuietOutput&) = delete;
+    QuietOutput& operator=(const QuietOutput&) = delete;
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_OUTPUT_H
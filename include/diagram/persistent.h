@@ -0,0 +1,281 @@
+// Persistent containers: versions share structure, and whoever changes a shared part copies
+// just that part first. Freezing is O(1) and makes every existing node immutable.
+#ifndef DIAGRAM_PERSISTENT_H
+#define DIAGRAM_PERSISTENT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "diagram/export.h"
+
+namespace diagram {
+
+namespace detail {
+// Process-wide unique id marking the nodes one editor may still change in place
+DIAGRAM_API std::uint64_t newEditToken();
+} // namespace detail
+
+// Persistent Array - Sparse array indexed by non-negative int, stored as a 32-way radix trie.
+// An editor changes nodes it created since its last freeze() in place and copies any other
+// node (and the path above it) before changing it, so share() after freeze() is O(1).
+template <typename T>
+class PersistentArray {
+    static constexpr unsigned kBits = 5;
+    static constexpr std::size_t kWidth = std::size_t(1) << kBits, kMask = kWidth - 1;
+
+    struct Node {
+        std::uint64_t owner = 0;
+        std::array<std::shared_ptr<Node>, kWidth> children;  // inner levels
+        std::vector<std::optional<T>> slots;                  // leaves only, kWidth entries
+    };
+
+    std::shared_ptr<Node> root;
+    unsigned shift = 0;  // the root covers indices below kWidth << shift
+    std::size_t count = 0;
+    std::uint64_t token = detail::newEditToken();
+
+    std::size_t capacity() const { return kWidth << shift; }
+
+    // Copy-on-write step: returns a node this editor may change, copying a frozen one first
+    Node* own(std::shared_ptr<Node>& node, bool leaf) {
+        if (node && node->owner == token) return node.get();
+        if (node) {
+            node = std::make_shared<Node>(*node);
+        } else {
+            node = std::make_shared<Node>();
+            if (leaf) node->slots.resize(kWidth);
+        }
+        node->owner = token;
+        return node.get();
+    }
+
+    std::optional<T>& editSlot(std::size_t i) {
+        if (!root) own(root, true);
+        while (i >= capacity()) {
+            auto top = std::make_shared<Node>();
+            top->owner = token;
+            top->children[0] = std::move(root);
+            root = std::move(top);
+            shift += kBits;
+        }
+        Node* node = own(root, shift == 0);
+        for (unsigned s = shift; s > 0; s -= kBits) node = own(node->children[(i >> s) & kMask], s == kBits);
+        return node->slots[i & kMask];
+    }
+
+    template <typename Fn>
+    static void walk(const Node* node, unsigned s, Fn& fn) {
+        if (!node) return;
+        if (s == 0) {
+            for (auto& v : node->slots)
+                if (v) fn(*v);
+            return;
+        }
+        for (auto& child : node->children) walk(child.get(), s - kBits, fn);
+    }
+public:
+    PersistentArray() = default;
+    PersistentArray(PersistentArray&&) noexcept = default;
+    PersistentArray& operator=(PersistentArray&&) noexcept = default;
+    PersistentArray(const PersistentArray&) = delete;
+    PersistentArray& operator=(const PersistentArray&) = delete;
+
+    std::size_t size() const { return count; }
+    bool contains(int id) const { return get(id) != nullptr; }
+
+    const T* get(int id) const {
+        if (id < 0 || !root || (std::size_t)id >= capacity()) return nullptr;
+        const Node* node = root.get();
+        for (unsigned s = shift; s > 0 && node; s -= kBits) node = node->children[((std::size_t)id >> s) & kMask].get();
+        if (!node) return nullptr;
+        auto& v = node->slots[(std::size_t)id & kMask];
+        return v ? &*v : nullptr;
+    }
+
+    // Writable element, or nullptr if absent; valid until the next change to the array
+    T* mutate(int id) {
+        if (!get(id)) return nullptr;
+        return &*editSlot((std::size_t)id);
+    }
+
+    T& set(int id, T value) {
+        auto& v = editSlot((std::size_t)id);
+        if (!v) ++count;
+        v = std::move(value);
+        return *v;
+    }
+
+    bool erase(int id) {
+        if (!get(id)) return false;
+        editSlot((std::size_t)id).reset();
+        --count;
+        return true;
+    }
+
+    // Visits elements in index order
+    template <typename Fn>
+    void forEach(Fn fn) const { walk(root.get(), shift, fn); }
+
+    // O(1): every existing node becomes immutable; later changes copy what they touch
+    void freeze() { token = detail::newEditToken(); }
+
+    // O(1): a new array sharing every node. Only valid on a frozen array or one that is never
+    // changed again, since the copy must not observe in-place changes
+    PersistentArray share() const {
+        PersistentArray copy;
+        copy.root = root;
+        copy.shift = shift;
+        copy.count = count;
+        return copy;
+    }
+};
+
+// Persistent Map - Hash trie with the same edit-token copy-on-write as PersistentArray. Keys live
+// in small buckets that split into 32-way nodes as they fill, so an edit copies one bucket and
+// the path above it
+template <typename K, typename V, typename Hash = std::hash<K>>
+class PersistentMap {
+    static constexpr unsigned kBits = 5;
+    static constexpr std::size_t kWidth = std::size_t(1) << kBits, kMask = kWidth - 1, kBucket = 8;
+
+    struct Node {
+        std::uint64_t owner = 0;
+        std::vector<std::shared_ptr<Node>> children;  // kWidth entries once split
+        std::vector<std::pair<K, V>> entries;          // until then
+    };
+
+    std::shared_ptr<Node> root;
+    std::size_t count = 0;
+    std::uint64_t token = detail::newEditToken();
+
+    // Spread the bits, since std::hash is the identity for integers
+    static std::uint64_t hashOf(const K& key) { return (std::uint64_t)Hash{}(key) * 0x9E3779B97F4A7C15ull; }
+
+    Node* own(std::shared_ptr<Node>& node) {
+        if (node && node->owner == token) return node.get();
+        node = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        node->owner = token;
+        return node.get();
+    }
+
+    // Writable value for key, inserting a default one if asked; copies the path on the way down
+    V* locate(const K& key, bool insert) {
+        std::uint64_t h = hashOf(key);
+        Node* node = own(root);
+        for (unsigned s = 0;; s += kBits) {
+            if (node->children.empty()) {
+                for (auto& e : node->entries)
+                    if (e.first == key) return &e.second;
+                if (!insert) return nullptr;
+                if (node->entries.size() < kBucket || s + kBits >= 64) {
+                    ++count;
+                    node->entries.emplace_back(key, V{});
+                    return &node->entries.back().second;
+                }
+                node->children.resize(kWidth);
+                for (auto& e : node->entries)
+                    own(node->children[(hashOf(e.first) >> s) & kMask])->entries.push_back(std::move(e));
+                node->entries.clear();
+            }
+            node = own(node->children[(h >> s) & kMask]);
+        }
+    }
+
+    template <typename Fn>
+    static void walk(const Node* node, Fn& fn) {
+        if (!node) return;
+        for (auto& e : node->entries) fn(e.first, e.second);
+        for (auto& child : node->children) walk(child.get(), fn);
+    }
+public:
+    PersistentMap() = default;
+    PersistentMap(PersistentMap&&) noexcept = default;
+    PersistentMap& operator=(PersistentMap&&) noexcept = default;
+    PersistentMap(const PersistentMap&) = delete;
+    PersistentMap& operator=(const PersistentMap&) = delete;
+
+    std::size_t size() const { return count; }
+
+    const V* find(const K& key) const {
+        std::uint64_t h = hashOf(key);
+        const Node* node = root.get();
+        for (unsigned s = 0; node; s += kBits) {
+            if (node->children.empty()) {
+                for (auto& e : node->entries)
+                    if (e.first == key) return &e.second;
+                return nullptr;
+            }
+            node = node->children[(h >> s) & kMask].get();
+        }
+        return nullptr;
+    }
+
+    // Writable value, or nullptr if absent; valid until the next change to the map
+    V* mutate(const K& key) { return find(key) ? locate(key, false) : nullptr; }
+    // Like operator[]: inserts a default value when absent
+    V& edit(const K& key) { return *locate(key, true); }
+
+    bool erase(const K& key) {
+        if (!find(key)) return false;
+        std::uint64_t h = hashOf(key);
+        Node* node = own(root);
+        for (unsigned s = 0; !node->children.empty(); s += kBits) node = own(node->children[(h >> s) & kMask]);
+        auto& entries = node->entries;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!(entries[i].first == key)) continue;
+            entries.erase(entries.begin() + (std::ptrdiff_t)i);
+            break;
+        }
+        --count;
+        return true;
+    }
+
+    // Visits entries in hash order
+    template <typename Fn>
+    void forEach(Fn fn) const { walk(root.get(), fn); }
+
+    void freeze() { token = detail::newEditToken(); }
+
+    // Same contract as PersistentArray::share()
+    PersistentMap share() const {
+        PersistentMap copy;
+        copy.root = root;
+        copy.count = count;
+        return copy;
+    }
+};
+
+// Copy-on-Write Value - Shared after freeze(), copied whole by the next edit()
+template <typename T>
+class CowValue {
+    std::shared_ptr<T> data = std::make_shared<T>();
+    bool frozen = false;
+public:
+    const T& read() const { return *data; }
+    T& edit() {
+        if (frozen) {
+            data = std::make_shared<T>(*data);
+            frozen = false;
+        }
+        return *data;
+    }
+    std::shared_ptr<const T> freeze() {
+        frozen = true;
+        return data;
+    }
+    // Continues from a published value; the next edit() copies it
+    void adopt(std::shared_ptr<const T> value) {
+        data = std::const_pointer_cast<T>(std::move(value));
+        frozen = true;
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_PERSISTENT_H
@@ -0,0 +1,154 @@
+// Type registry: graph builders, figure flyweights and diagram element kinds are looked up by
+// name here instead of in factory if/else chains, so new types (built in, self-registered or
+// loaded from a plugin) dispatch the same way.
+#ifndef DIAGRAM_REGISTRY_H
+#define DIAGRAM_REGISTRY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "diagram/builder.h"
+#include "diagram/export.h"
+#include "diagram/flyweight.h"
+#include "diagram/instrumentation.h"
+
+namespace diagram {
+
+class DiagramFactory;
+
+// Perfect Hash - Immutable name table built once from a fixed key set (hash and displace): the
+// name's hash picks a bucket, the bucket's seed picks a slot no other name uses, so a lookup is
+// two array reads and one string compare. Entry indexes follow the build order
+template <typename V>
+class PerfectHashTable {
+public:
+    struct Entry {
+        std::string name;
+        V value;
+    };
+private:
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> seeds;  // per bucket
+    std::vector<std::int32_t> slots;   // entry index, or -1
+    std::size_t bucketMask = 0, slotMask = 0;
+
+    static std::uint64_t hashName(std::string_view name) {
+        std::uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : name) h = (h ^ c) * 1099511628211ull;
+        return h;
+    }
+    static std::uint64_t mix(std::uint64_t h, std::uint32_t seed) {
+        h ^= (seed + 1) * 0x9E3779B97F4A7C15ull;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return h ^ (h >> 31);
+    }
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+public:
+    // Names must be unique
+    explicit PerfectHashTable(std::vector<Entry> list = {}) : entries(std::move(list)) {
+        std::size_t n = entries.size();
+        seeds.assign(roundUp(n / 4 + 1), 0);
+        slots.assign(roundUp(2 * n + 1), -1);
+        bucketMask = seeds.size() - 1;
+        slotMask = slots.size() - 1;
+        std::vector<std::vector<std::int32_t>> buckets(seeds.size());
+        for (std::size_t i = 0; i < n; ++i) buckets[hashName(entries[i].name) & bucketMask].push_back((std::int32_t)i);
+        // Largest buckets first, while most slots are still free
+        std::vector<std::size_t> order(buckets.size());
+        for (std::size_t b = 0; b < order.size(); ++b) order[b] = b;
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return buckets[a].size() > buckets[b].size(); });
+        std::vector<std::size_t> placed;
+        for (std::size_t b : order) {
+            if (buckets[b].empty()) break;
+            for (std::uint32_t seed = 0;; ++seed) {
+                placed.clear();
+                for (std::int32_t e : buckets[b]) {
+                    std::size_t s = mix(hashName(entries[(std::size_t)e].name), seed) & slotMask;
+                    if (slots[s] >= 0) break;
+                    slots[s] = e;
+                    placed.push_back(s);
+                }
+                if (placed.size() == buckets[b].size()) {
+                    seeds[b] = seed;
+                    break;
+                }
+                for (std::size_t s : placed) slots[s] = -1;
+            }
+        }
+    }
+
+    // Entry index, or -1 for a name not in the table
+    int find(std::string_view name) const {
+        std::uint64_t h = hashName(name);
+        std::int32_t e = slots[mix(h, seeds[h & bucketMask]) & slotMask];
+        return e >= 0 && entries[(std::size_t)e].name == name ? e : -1;
+    }
+    const Entry& at(int index) const { return entries[(std::size_t)index]; }
+    std::size_t size() const { return entries.size(); }
+    const std::vector<Entry>& list() const { return entries; }
+};
+
+// Plugin Registry - Singleton mapping type names to constructors. Registration is rare and
+// rebuilds the affected perfect-hash table; lookups read the current table without locking, and
+// a replaced table is freed as soon as no lookup still reads it
+class DIAGRAM_API TypeRegistry {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    TypeRegistry();
+public:
+    using BuilderMaker = std::function<std::unique_ptr<Builder>()>;
+    using FigureMaker = std::function<std::shared_ptr<FlyweightFigure>(const std::string& type)>;
+    using ElementMaker = std::function<int(DiagramFactory& factory, const std::string& type, const std::string& coord)>;
+
+    static TypeRegistry& getInstance();
+    TypeRegistry(const TypeRegistry&) = delete;
+    TypeRegistry& operator=(const TypeRegistry&) = delete;
+    ~TypeRegistry();
+
+    // False if the name is already taken; the first registration wins
+    bool registerGraph(std::string type, BuilderMaker make);
+    bool registerFigure(std::string type, FigureMaker make);
+    bool registerElement(std::string element, ElementMaker make);
+
+    // Dense id of a graph type in registration order, or -1; stable for the process lifetime,
+    // so GraphFactory keeps its builders in an array indexed by it
+    int graphSlot(std::string_view type) const;
+    std::unique_ptr<Builder> makeBuilder(int slot) const;
+    // nullptr if the type has no registered figure
+    std::shared_ptr<FlyweightFigure> makeFigure(const std::string& type) const;
+    // Runs the element kind's constructor; -1 if the kind is unknown
+    int makeElement(DiagramFactory& factory, const std::string& element, const std::string& type,
+                    const std::string& coord) const;
+
+    // Loads a shared-object plugin and calls its entry point
+    //     extern "C" void diagram_register_types(diagram::TypeRegistry& registry);
+    // which registers through the registry it is given. The plugin stays loaded; false (with the
+    // loader's message in error) if it cannot be loaded or has no entry point
+    bool loadPlugin(const std::string& path, std::string* error = nullptr);
+};
+
+} // namespace diagram
+
+// Static self-registration from any translation unit linked into the program
+#define DIAGRAM_REGISTER_GRAPH(name, BuilderType)                                                  \
+    static const bool DIAGRAM_CONCAT(graphRegistered, __LINE__) =                                  \
+        ::diagram::TypeRegistry::getInstance().registerGraph(                                      \
+            name, [] { return std::unique_ptr<::diagram::Builder>(new BuilderType()); })
+#define DIAGRAM_REGISTER_FIGURE(name, FigureType)                                                  \
+    static const bool DIAGRAM_CONCAT(figureRegistered, __LINE__) =                                 \
+        ::diagram::TypeRegistry::getInstance().registerFigure(                                     \
+            name, [](const std::string& type) { return std::make_shared<FigureType>(type); })
+
+#endif // DIAGRAM_REGISTRY_H
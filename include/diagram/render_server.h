@@ -0,0 +1,79 @@
+// Headless render server: scene requests over a local Unix socket, rendered on a worker
+// pool and answered with PGM images.
+#ifndef DIAGRAM_RENDER_SERVER_H
+#define DIAGRAM_RENDER_SERVER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "diagram/export.h"
+#include "diagram/flyweight.h"
+
+namespace diagram {
+
+// Render Server - One element of a requested scene, as handed to DiagramFactory::getDiagram
+struct RenderItem {
+    std::string element, type, coord;
+};
+
+// Render Server - Parsed request line:
+//   RENDER <width> <height> <centerX> <centerY> <viewWidth> <viewHeight> [budgetMs] | <element> <type> <coord>; ...
+// e.g. "RENDER 200 200 50 50 100 100 | Graph Bar (10,20); Figure CircleColor (5,5)"
+struct RenderRequest {
+    int width = 0, height = 0;
+    double centerX = 0, centerY = 0, viewWidth = 0, viewHeight = 0;
+    int budgetMs = 0;  // 0 uses the server's latency budget
+    std::vector<RenderItem> items;
+    // Requests with equal keys describe the same scene and are rendered from one build
+    std::string sceneKey;
+};
+
+// Returns false (with a reason) for malformed lines or oversized images
+DIAGRAM_API bool parseRenderRequest(const std::string& line, RenderRequest& request, std::string& error);
+
+// Binary PGM (P5) of the canvas
+DIAGRAM_API std::string encodePgm(const Canvas& canvas);
+
+struct RenderServerOptions {
+    std::string socketPath = "/tmp/diagram.sock";
+    // Batches rendered concurrently; they run on the shared Executor, not on threads of their own
+    size_t workers = std::thread::hardware_concurrency();
+    // Admission control - requests beyond this many queued, or whose predicted wait already
+    // exceeds their budget, are refused with BUSY instead of queueing
+    size_t maxQueued = 1024;
+    std::chrono::milliseconds latencyBudget{50};
+    size_t maxBatch = 64;  // requests rendered from one scene build
+};
+
+struct RenderServerStats {
+    uint64_t accepted = 0, rejected = 0, expired = 0, rendered = 0, batches = 0, malformed = 0;
+    uint64_t failed = 0;  // answered ERR because building or rendering their batch threw
+};
+
+// Render Server - Unix socket front end and earliest-deadline-first queue drained on the Executor.
+// Each connection is request/response: the next line is read once the previous one is answered with
+//   OK <bytes>\n<PGM image> | BUSY\n | TIMEOUT\n | ERR <reason>\n
+class DIAGRAM_API RenderServer {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+public:
+    explicit RenderServer(RenderServerOptions options = {});
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+    ~RenderServer();
+
+    // Binds the socket and starts the I/O thread; false if the socket cannot be bound
+    bool start();
+    // Stops accepting, answers queued requests with BUSY and waits for batches in progress
+    void stop();
+    RenderServerStats stats() const;
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_RENDER_SERVER_H
@@ -0,0 +1,195 @@
+// Scene graph: element placement, camera, dependency-driven recalculation, batched rendering
+// and copy-on-write snapshots for concurrent readers.
+#ifndef DIAGRAM_SCENE_H
+#define DIAGRAM_SCENE_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "diagram/elements.h"
+#include "diagram/export.h"
+#include "diagram/flyweight.h"
+#include "diagram/persistent.h"
+
+namespace diagram {
+
+// Scene Geometry - World-space point and axis-aligned bounds
+struct Point {
+    double x = 0, y = 0;
+};
+
+struct Bounds {
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool intersects(const Bounds& o) const {
+        return minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY;
+    }
+};
+
+// Parses the "(x,y)" coordinate strings handed to the factories
+inline Point parseCoord(const std::string& coord) {
+    Point p;
+    std::sscanf(coord.c_str(), " (%lf , %lf )", &p.x, &p.y);
+    return p;
+}
+
+// Camera - Visible world rectangle, panned and zoomed around its center
+class Viewport {
+    Point center;
+    double width, height;
+    int screenW = 100, screenH = 100;
+public:
+    Viewport(double cx = 50, double cy = 50, double w = 100, double h = 100)
+        : center{cx, cy}, width(w), height(h) {}
+    void resizeScreen(int w, int h) { screenW = w; screenH = h; }
+    int screenWidth() const { return screenW; }
+    int screenHeight() const { return screenH; }
+    void pan(double dx, double dy) { center.x += dx; center.y += dy; }
+    void zoom(double factor) {
+        if (factor <= 0) return;
+        width /= factor;
+        height /= factor;
+    }
+    Bounds visibleArea() const {
+        return {center.x - width / 2, center.y - height / 2,
+                center.x + width / 2, center.y + height / 2};
+    }
+};
+
+// Dependency Tracking - Inputs an element's computed layout can depend on
+enum SceneInput : unsigned {
+    InputCoord = 1u << 0,
+    InputData  = 1u << 1,
+    InputStyle = 1u << 2,
+    InputAxis  = 1u << 3,
+    InputAll   = InputCoord | InputData | InputStyle | InputAxis
+};
+
+struct AxisSettings {
+    double min = 0, max = 0;
+    bool autoRange = true;
+};
+
+// Scene - Every element created through the factories, with its world bounds
+struct SceneElement {
+    int id;
+    std::string element, type, coord;
+    Bounds bounds;
+    std::shared_ptr<Diagram> diagram;
+    std::shared_ptr<FlyweightFigure> flyweight;
+    unsigned dependsOn = InputCoord | InputStyle;
+    unsigned dirty = InputAll;
+    std::string series, axisGroup, style;
+    AxisSettings axis;
+};
+
+// Series values are immutable once stored, so versions share them
+using SeriesTable = std::unordered_map<std::string, std::shared_ptr<const std::vector<double>>>;
+using AxisTable = std::unordered_map<std::string, AxisSettings>;
+
+class SpatialIndex;
+class DependencyGraph;
+
+// Scene Version - Everything a snapshot captures, derived indexes included; never changed once published
+struct SceneVersion {
+    PersistentArray<SceneElement> elements;
+    std::shared_ptr<const SeriesTable> series;
+    std::shared_ptr<const AxisTable> axes;
+    std::shared_ptr<const SpatialIndex> index;
+    std::shared_ptr<const DependencyGraph> deps;
+    int nextId = 0;
+};
+
+// Scene Snapshot - Consistent read-only view of a scene at one point in time; cheap to copy
+// and safe to read from any thread while the scene keeps being edited
+class DIAGRAM_API SceneSnapshot {
+    std::shared_ptr<const SceneVersion> version;
+    friend class Scene;
+public:
+    explicit SceneSnapshot(std::shared_ptr<const SceneVersion> v) : version(std::move(v)) {}
+    size_t size() const { return version->elements.size(); }
+    const SceneElement* element(int id) const { return version->elements.get(id); }
+    const PersistentArray<SceneElement>& allElements() const { return version->elements; }
+    const SeriesTable& allSeries() const { return *version->series; }
+    const std::vector<double>* seriesValues(const std::string& name) const {
+        auto it = version->series->find(name);
+        return it == version->series->end() ? nullptr : it->second.get();
+    }
+    // Rasterizes the figures visible through the camera; no calc()/draw() stubs run, since the
+    // diagrams are shared with the editor
+    void render(const Viewport& camera, Canvas& frame) const;
+};
+
+class DIAGRAM_API Scene {
+    PersistentArray<SceneElement> elements;
+    CowValue<SeriesTable> seriesData;
+    CowValue<AxisTable> axisGroups;
+    std::unique_ptr<DependencyGraph> deps;
+    std::unique_ptr<SpatialIndex> index;
+    Viewport camera;
+    Canvas frame;
+    std::vector<float> batchX, batchY;
+    int nextId = 0;
+
+    // Copies the element's chunk first if a snapshot still shares it
+    SceneElement* find(int id) { return elements.mutate(id); }
+    void markDirty(SceneElement& e, unsigned inputs) { e.dirty |= inputs & e.dependsOn; }
+    Bounds boundsAt(const std::string& element, const std::string& coord) const {
+        Point p = parseCoord(coord);
+        double extent = element == "Graph" ? kGraphExtent : kFigureExtent;
+        return {p.x, p.y, p.x + extent, p.y + extent};
+    }
+public:
+    static constexpr double kGraphExtent = 10.0;
+    static constexpr double kFigureExtent = 1.0;
+
+    Scene();
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+    ~Scene();
+
+    // A requested id (e.g. from a saved scene) is kept unless already taken
+    int add(std::string element, std::string type, std::string coord, std::shared_ptr<Diagram> diagram,
+            std::shared_ptr<FlyweightFigure> flyweight = nullptr, int requestedId = -1);
+    void remove(int id);
+    size_t size() const { return elements.size(); }
+    Viewport& viewport() { return camera; }
+    const Canvas& lastFrame() const { return frame; }
+    const PersistentArray<SceneElement>& allElements() const { return elements; }
+    const SeriesTable& allSeries() const { return seriesData.read(); }
+    // O(1); the editor then copies only the element chunks (and tables) it changes
+    SceneSnapshot snapshot();
+    // O(1): continues from an earlier snapshot's version (elements, series, axes, indexes and
+    // ids); the camera and last frame are kept
+    void restore(const SceneSnapshot& snapshot);
+
+    // Edits - each marks only the elements whose layout consumes the changed input
+    void move(int id, std::string coord);
+    void setStyle(int id, std::string style) {
+        auto* e = find(id);
+        if (!e || e->style == style) return;
+        e->style = style;
+        markDirty(*e, InputStyle);
+    }
+    void bindSeries(int id, std::string name);
+    void updateSeries(const std::string& name, std::vector<double> values);
+    const std::vector<double>* seriesValues(const std::string& name) const {
+        auto it = seriesData.read().find(name);
+        return it == seriesData.read().end() ? nullptr : it->second.get();
+    }
+    void linkAxis(int id, std::string group);
+    void setAxis(const std::string& group, AxisSettings settings);
+
+    // Frustum culling - only elements intersecting the camera reach calc()/draw();
+    // the pointers are valid until the next edit
+    std::vector<const SceneElement*> visibleElements() const;
+    // Incremental recalculation - clean elements are drawn from their last layout;
+    // off-screen elements keep their dirty bits until they scroll into view
+    void render();
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_SCENE_H
@@ -0,0 +1,114 @@
+// Binary scene file format: writer entry point and a zero-copy memory-mapped reader.
+#ifndef DIAGRAM_SCENE_FILE_H
+#define DIAGRAM_SCENE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "diagram/export.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+// Scene File - Versioned binary layout designed to be memory-mapped and read in place:
+// header, flat fixed-size element table, series table, string table, then series blobs
+struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    uint64_t elementCount, elementOffset;
+    uint64_t seriesCount, seriesOffset;
+    uint64_t stringTableSize, stringTableOffset;
+    uint64_t journalSeq;  // version 2: last journal record the scene includes (0 if none)
+};
+
+struct SceneFileElement {
+    int32_t id;
+    uint32_t kind;  // SceneFileKind
+    uint32_t type, coord, style, axisGroup, series;  // string table offsets; kNoString if unset
+    uint32_t dependsOn;
+    double minX, minY, maxX, maxY;
+    double axisMin, axisMax;
+    uint32_t axisAuto;
+    uint32_t reserved;
+};
+
+struct SceneFileSeries {
+    uint32_t name;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t dataOffset;  // count doubles
+};
+
+enum SceneFileKind : uint32_t { KindGraph = 0, KindFigure = 1 };
+
+constexpr char kSceneMagic[8] = {'D', 'G', 'S', 'C', 'E', 'N', 'E', 0};
+constexpr uint32_t kSceneVersion = 2;
+constexpr uint32_t kByteOrderTag = 0x01020304;
+constexpr uint32_t kNoString = 0xffffffffu;
+
+// Scene File - Writes the scene in the layout above; false if the file could not be written.
+// journalSeq marks the journal records a checkpoint already covers
+DIAGRAM_API bool writeSceneFile(const Scene& scene, const std::string& path, std::uint64_t journalSeq = 0);
+// Same, from a snapshot; lets an export thread write while the scene keeps being edited
+DIAGRAM_API bool writeSceneFile(const SceneSnapshot& snapshot, const std::string& path, std::uint64_t journalSeq = 0);
+
+// Scene File - Read-only view over a mapped file; opening validates the header and table
+// bounds only, elements and series are read in place on access
+class DIAGRAM_API SceneView {
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> owned;
+#endif
+    SceneView() = default;
+
+    const SceneFileHeader& header() const { return *(const SceneFileHeader*)base; }
+    // Version 1 headers end before journalSeq
+    static size_t headerSize(uint32_t version) {
+        return version == 1 ? offsetof(SceneFileHeader, journalSeq) : sizeof(SceneFileHeader);
+    }
+    bool valid() const;
+public:
+    SceneView(const SceneView&) = delete;
+    SceneView& operator=(const SceneView&) = delete;
+    ~SceneView();
+
+    // Returns nullptr if the file is missing, truncated or from an unknown format version
+    static std::unique_ptr<SceneView> open(const std::string& path);
+
+    std::uint64_t journalSeq() const { return header().version >= 2 ? header().journalSeq : 0; }
+
+    size_t elementCount() const { return header().elementCount; }
+    const SceneFileElement& element(size_t i) const {
+        return ((const SceneFileElement*)(base + header().elementOffset))[i];
+    }
+    const char* str(uint32_t offset) const {
+        return offset < header().stringTableSize ? base + header().stringTableOffset + offset : "";
+    }
+    size_t seriesCount() const { return header().seriesCount; }
+    const SceneFileSeries& series(size_t i) const {
+        return ((const SceneFileSeries*)(base + header().seriesOffset))[i];
+    }
+    const double* seriesData(size_t i) const {
+        auto& s = series(i);
+        bool inFile = s.dataOffset <= length && s.count <= (length - s.dataOffset) / sizeof(double);
+        return inFile ? (const double*)(base + s.dataOffset) : nullptr;
+    }
+    // Culls straight off the mapped table, without building a Scene
+    template <typename Fn>
+    void forEachInArea(const Bounds& area, Fn fn) const {
+        for (size_t i = 0; i < elementCount(); ++i) {
+            auto& e = element(i);
+            if (Bounds{e.minX, e.minY, e.maxX, e.maxY}.intersects(area)) fn(e);
+        }
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_SCENE_FILE_H
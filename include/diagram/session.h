@@ -0,0 +1,44 @@
+// Sessions: many independent documents hosted in one process. Each document owns its scene,
+// history, builders and flyweights; only immutable figure geometry is shared between them.
+#ifndef DIAGRAM_SESSION_H
+#define DIAGRAM_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "diagram/async.h"
+#include "diagram/diagram_factory.h"
+#include "diagram/export.h"
+
+namespace diagram {
+
+// Session - Registry of open documents; edits to one document are serialized, edits to
+// different documents run in parallel without sharing a lock
+class DIAGRAM_API Session {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+public:
+    using DocumentId = std::uint64_t;
+
+    Session();
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    ~Session();
+
+    // Ids are never reused within a session
+    DocumentId open();
+    // An edit already running on the document finishes first; returns false for unknown ids
+    bool close(DocumentId id);
+    std::size_t documents() const;
+
+    // Runs fn with exclusive access to the document; returns false for unknown ids
+    bool edit(DocumentId id, const std::function<void(DiagramFactory&)>& fn);
+    // Runs edit on the shared Executor; the session must outlive the task
+    Task<bool> editAsync(DocumentId id, std::function<void(DiagramFactory&)> fn);
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_SESSION_H
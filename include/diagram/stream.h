@@ -0,0 +1,116 @@
+// Live series for streaming line graphs: a producer thread appends points through a lock-free
+// ring while the drawing thread scrolls a fixed window and redraws only what changed.
+#ifndef DIAGRAM_STREAM_H
+#define DIAGRAM_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "diagram/export.h"
+#include "diagram/kernels.h"
+
+namespace diagram {
+
+// Ring Buffer - Fixed-capacity single-producer / single-consumer queue. Each side owns one index
+// and keeps a cached copy of the other's, so the shared cache lines are only read when the
+// ring looks full (producer) or empty (consumer)
+template <typename T>
+class SpscRing {
+    static constexpr std::size_t kLine = 64;
+    std::vector<T> slots;
+    std::size_t mask;
+    alignas(kLine) std::atomic<std::size_t> head{0};  // next read; written by the consumer
+    std::size_t cachedTail = 0;
+    alignas(kLine) std::atomic<std::size_t> tail{0};  // next write; written by the producer
+    std::size_t cachedHead = 0;
+
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(std::size_t capacity) : slots(roundUp(capacity < 2 ? 2 : capacity)), mask(slots.size() - 1) {}
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const { return slots.size(); }
+
+    // Producer only; false when the ring is full
+    bool push(const T& value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == slots.size()) return false;
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; hands up to max queued values to fn in order and returns how many
+    template <typename Fn>
+    std::size_t drain(Fn fn, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) cachedTail = tail.load(std::memory_order_acquire);
+        std::size_t n = cachedTail - h < max ? cachedTail - h : max;
+        for (std::size_t i = 0; i < n; ++i) fn(slots[(h + i) & mask]);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+};
+
+struct StreamPoint {
+    double x = 0, y = 0;
+};
+
+// What one refresh changed. Points [redrawFrom, size) of the window need drawing; when the axes
+// were rescaled that is the whole window, otherwise just the points scrolled in (plus the one
+// before them, which their first segment starts from)
+struct StreamUpdate {
+    std::size_t added = 0, scrolledOut = 0, dropped = 0;
+    std::size_t redrawFrom = 0, size = 0;
+    ValueRange x, y;  // axis ranges after the update
+    bool rescaled = false;
+};
+
+// Live Series - Sliding window over the last `window` points of a stream whose x values never
+// decrease (timestamps). The y axis covers the window with some headroom and is only rescaled
+// when the data leaves it or shrinks to less than half of it; the window's min and max are kept
+// in monotonic queues, so each refresh costs O(points added) however large the window
+class DIAGRAM_API LiveSeries {
+    SpscRing<StreamPoint> incoming;
+    std::vector<StreamPoint> points;  // circular, oldest at first
+    std::size_t first = 0, count = 0;
+    std::uint64_t seen = 0;  // points accepted so far; numbers the monotonic queue entries
+    std::deque<std::pair<std::uint64_t, double>> lows, highs;
+    std::atomic<std::size_t> droppedPoints{0};
+    std::size_t droppedReported = 0;
+    ValueRange axisY;
+    bool hasAxis = false;
+
+    void accept(const StreamPoint& p);
+public:
+    // capacity bounds the points queued between refreshes; window bounds the points shown
+    LiveSeries(std::size_t capacity, std::size_t window);
+
+    // Producer thread only; a point that finds the ring full is dropped and counted
+    bool append(double x, double y);
+
+    // Drawing thread only: moves queued points into the window and updates the axes
+    StreamUpdate refresh();
+
+    std::size_t size() const { return count; }
+    // i-th visible point, oldest first
+    const StreamPoint& at(std::size_t i) const { return points[(first + i) % points.size()]; }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_STREAM_H
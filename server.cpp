@@ -0,0 +1,57 @@
+// Headless render server.
+//   ./build/diagram_server --socket=/tmp/diagram.sock --workers=8 --budget-ms=50
+//   printf 'RENDER 200 200 50 50 100 100 | Graph Bar (10,20); Figure CircleColor (5,5)\n' | nc -U /tmp/diagram.sock
+#include "diagram/diagram.h"
+#include "diagram/render_server.h"
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace diagram;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) { stopRequested = 1; }
+
+int main(int argc, char** argv) {
+    RenderServerOptions options;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) options.socketPath = arg.substr(9);
+        else if (arg.rfind("--workers=", 0) == 0) options.workers = stoul(arg.substr(10));
+        else if (arg.rfind("--max-queue=", 0) == 0) options.maxQueued = stoul(arg.substr(12));
+        else if (arg.rfind("--budget-ms=", 0) == 0) options.latencyBudget = chrono::milliseconds(stol(arg.substr(12)));
+        else if (arg.rfind("--max-batch=", 0) == 0) options.maxBatch = stoul(arg.substr(12));
+        else if (arg == "--verbose") verbose = true;
+        else {
+            cerr << "usage: diagram_server [--socket=PATH] [--workers=N] [--max-queue=N] [--budget-ms=T] "
+                    "[--max-batch=N] [--verbose]\n";
+            return 1;
+        }
+    }
+    // Stub lines from every request would swamp the log; --verbose keeps them
+    if (!verbose) Output::getInstance().setSink(make_shared<NullSink>());
+
+    RenderServer server(options);
+    if (!server.start()) {
+        cerr << "cannot listen on " << options.socketPath << "\n";
+        return 1;
+    }
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    cerr << "listening on " << options.socketPath << "\n";
+    while (!stopRequested) this_thread::sleep_for(chrono::milliseconds(100));
+    server.stop();
+
+    auto s = server.stats();
+    cerr << "accepted " << s.accepted << ", rejected " << s.rejected << ", expired " << s.expired
+         << ", malformed " << s.malformed << ", failed " << s.failed << ", rendered " << s.rendered << " in "
+         << s.batches << " batches\n";
+#ifdef DIAGRAM_INSTRUMENT
+    Instrumentation::getInstance().dump(cerr);
+#endif
+    return 0;
+}
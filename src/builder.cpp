@@ -0,0 +1,111 @@
+#include "diagram/builder.h"
+#include "diagram/instrumentation.h"
+#include "diagram/registry.h"
+
+using namespace std;
+
+namespace diagram {
+
+BarBuilder& BarBuilder::getInstance() {
+    static BarBuilder instance;
+    return instance;
+}
+
+LineBuilder& LineBuilder::getInstance() {
+    static LineBuilder instance;
+    return instance;
+}
+
+void LineBuilder::startStream(size_t capacity, size_t window) {
+    live = make_unique<LiveSeries>(capacity, window);
+}
+
+StreamUpdate LineBuilder::refresh() {
+    if (!live) return {};
+    StreamUpdate u = live->refresh();
+    if (u.added == 0 && !u.rescaled) return u;
+    out() << "Line update at " << coord << ": " << u.added << " new points, redraw " << (u.size - u.redrawFrom)
+          << " of " << u.size << (u.rescaled ? " (rescaled)" : "") << "\n";
+    return u;
+}
+
+void BarBuilder::calc() {
+    if (!data.keys) {
+        bars = {};
+        out() << "Bar calc at " << coord << "\n";
+        return;
+    }
+    bars = aggregate(data.keys, data.ys, data.count, data.aggregation);
+    out() << "Bar calc at " << coord << ": " << data.count << " rows into " << bars.keys.size() << " bars\n";
+}
+
+void ScatterBuilder::calc() {
+    bool points = data.xs && data.ys;
+    density = points ? splat(data.xs, data.ys, nullptr, data.count, kGridSize, kGridSize) : DensityGrid{};
+    out() << "Scatter calc at " << coord << ": " << (points ? data.count : 0) << " points, peak density "
+          << density.peak << "\n";
+}
+
+void AreaBuilder::calc() {
+    bool points = data.xs && data.ys;
+    profile = points ? areaProfile(data.xs, data.ys, data.count, kColumns) : AreaProfile{};
+    out() << "Area calc at " << coord << ": " << (points ? data.count : 0) << " points, area " << profile.area << "\n";
+}
+
+void HistogramBuilder::calc() {
+    size_t n = data.xs ? data.count : 0;
+    bins = histogram(data.xs, n, kBins);
+    out() << "Histogram calc at " << coord << ": " << n << " values in " << kBins << " bins\n";
+}
+
+void HeatmapBuilder::calc() {
+    bool points = data.xs && data.ys;
+    heat = points ? splat(data.xs, data.ys, data.weights, data.count, kGridSize, kGridSize) : DensityGrid{};
+    out() << "Heatmap calc at " << coord << ": " << (points ? data.count : 0) << " points, peak " << heat.peak << "\n";
+}
+
+void Director::construct(string, string coord) {
+    DIAGRAM_TIME_STAGE(StageConstruct);
+    { DIAGRAM_TIME_STAGE(StageSetCoord); builder->setCoord(coord); }
+    { DIAGRAM_TIME_STAGE(StageCalc); builder->calc(); }
+    { DIAGRAM_TIME_STAGE(StageDraw); builder->draw(); }
+    { DIAGRAM_TIME_STAGE(StageDrag); builder->drag(); }
+}
+
+bool GraphFactory::createGraph(string type, string coord, const GraphData& data) {
+    DIAGRAM_TRACE_SCOPE("factory", "GraphFactory::createGraph");
+    TypeRegistry& registry = TypeRegistry::getInstance();
+    int slot = registry.graphSlot(type);
+    if (slot < 0) return false;
+    Director d;
+    lock_guard<mutex> guard(constructLock);
+    Builder* builder = ownedBuilder(slot);
+    if (!builder) return false;
+    builder->setData(data);
+    d.setBuilder(builder);
+    d.construct(type, coord);
+    // The data is only borrowed for this construction
+    builder->setData({});
+    return true;
+}
+
+Builder* GraphFactory::ownedBuilder(int slot) {
+    if ((size_t)slot >= builders.size()) builders.resize((size_t)slot + 1);
+    auto& owned = builders[(size_t)slot];
+    if (!owned) owned = TypeRegistry::getInstance().makeBuilder(slot);
+    return owned.get();
+}
+
+Builder* GraphFactory::builder(const string& type) {
+    int slot = TypeRegistry::getInstance().graphSlot(type);
+    if (slot < 0) return nullptr;
+    lock_guard<mutex> guard(constructLock);
+    return ownedBuilder(slot);
+}
+
+Task<bool> GraphFactory::createGraphAsync(string type, string coord) {
+    co_await Executor::getInstance().schedule();
+    co_return createGraph(std::move(type), std::move(coord));
+}
+
+} // namespace diagram
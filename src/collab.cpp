@@ -0,0 +1,313 @@
+#include "diagram/collab.h"
+#include "diagram/command.h"
+#include "diagram/flyweight.h"
+#include "diagram/instrumentation.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+using namespace std;
+
+namespace diagram {
+
+static void putVarint(string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+static bool getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char b = (unsigned char)*p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Deltas between consecutive ops are usually +1, but batches may mix replicas
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// Batch: [count][string count][strings: len, bytes]...[ops]
+// Op: [kind][replica][seq delta][lamport delta] then Create: [element][type][coord] string indices,
+// Move: [target replica][target seq][coord], Remove: [target replica][target seq]
+string encodeOps(const vector<Operation>& ops) {
+    vector<const string*> strings;
+    unordered_map<string, uint64_t> interned;
+    auto intern = [&](const string& s) {
+        auto slot = interned.emplace(s, strings.size());
+        if (slot.second) strings.push_back(&slot.first->first);
+        return slot.first->second;
+    };
+    string body;
+    uint64_t prevSeq = 0, prevLamport = 0;
+    for (auto& op : ops) {
+        body.push_back((char)op.kind);
+        putVarint(body, op.id.replica);
+        putVarint(body, zigzag((int64_t)(op.id.seq - prevSeq)));
+        putVarint(body, zigzag((int64_t)(op.lamport - prevLamport)));
+        prevSeq = op.id.seq;
+        prevLamport = op.lamport;
+        if (op.kind == OpKind::Create) {
+            putVarint(body, intern(op.element));
+            putVarint(body, intern(op.type));
+            putVarint(body, intern(op.coord));
+            continue;
+        }
+        putVarint(body, op.target.replica);
+        putVarint(body, op.target.seq);
+        if (op.kind == OpKind::Move) putVarint(body, intern(op.coord));
+    }
+    string out;
+    putVarint(out, ops.size());
+    putVarint(out, strings.size());
+    for (auto* s : strings) {
+        putVarint(out, s->size());
+        out += *s;
+    }
+    return out + body;
+}
+
+bool decodeOps(const string& batch, vector<Operation>& ops) {
+    const char* p = batch.data();
+    const char* end = p + batch.size();
+    uint64_t count, stringCount;
+    // Every op and string takes at least one byte, which bounds the counts before reserving
+    if (!getVarint(p, end, count) || !getVarint(p, end, stringCount)) return false;
+    if (count > (uint64_t)(end - p) || stringCount > (uint64_t)(end - p)) return false;
+    vector<string> strings;
+    strings.reserve(stringCount);
+    for (uint64_t i = 0; i < stringCount; ++i) {
+        uint64_t len;
+        if (!getVarint(p, end, len) || len > (uint64_t)(end - p)) return false;
+        strings.emplace_back(p, (size_t)len);
+        p += len;
+    }
+    auto str = [&](string& s) {
+        uint64_t index;
+        if (!getVarint(p, end, index) || index >= strings.size()) return false;
+        s = strings[index];
+        return true;
+    };
+    ops.clear();
+    ops.reserve(count);
+    uint64_t prevSeq = 0, prevLamport = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (p >= end) return false;
+        Operation op;
+        op.kind = (OpKind)*p++;
+        uint64_t replica, seqDelta, lamportDelta;
+        if (!getVarint(p, end, replica) || !getVarint(p, end, seqDelta) || !getVarint(p, end, lamportDelta)) return false;
+        op.id = {(uint32_t)replica, prevSeq + (uint64_t)unzigzag(seqDelta)};
+        op.lamport = prevLamport + (uint64_t)unzigzag(lamportDelta);
+        prevSeq = op.id.seq;
+        prevLamport = op.lamport;
+        if (op.kind == OpKind::Create) {
+            if (!str(op.element) || !str(op.type) || !str(op.coord)) return false;
+        } else if (op.kind == OpKind::Move || op.kind == OpKind::Remove) {
+            uint64_t targetReplica;
+            if (!getVarint(p, end, targetReplica) || !getVarint(p, end, op.target.seq)) return false;
+            op.target.replica = (uint32_t)targetReplica;
+            if (op.kind == OpKind::Move && !str(op.coord)) return false;
+        } else {
+            return false;
+        }
+        ops.push_back(std::move(op));
+    }
+    return p == end;
+}
+
+struct OpIdHash {
+    size_t operator()(const OpId& id) const { return hash<uint64_t>{}((id.seq << 20) ^ id.replica); }
+};
+
+struct Replica::Impl {
+    // Element state; tombstones are kept so late moves of a removed element are ignored
+    struct Record {
+        int sceneId = -1;
+        string element, type, coord;
+        uint64_t lamport = 0;  // stamp of the write that set coord
+        uint32_t writer = 0;
+        bool removed = false;
+    };
+
+    uint32_t self;
+    DiagramFactory& document;
+    GraphFactory graphs;
+    FigureFactory figures;
+    uint64_t seq = 0, clock = 0;
+    unordered_map<OpId, Record, OpIdHash> elements;
+    unordered_map<uint32_t, uint64_t> applied;  // highest sequence applied, per replica
+    unordered_map<uint32_t, map<uint64_t, Operation>> waiting;
+    size_t waitingCount = 0;
+    vector<Operation> outgoing;
+
+    Impl(uint32_t id, DiagramFactory& doc) : self(id), document(doc) {}
+
+    uint64_t appliedSeq(uint32_t replica) const {
+        auto it = applied.find(replica);
+        return it == applied.end() ? 0 : it->second;
+    }
+    bool delivered(const OpId& op) const { return op.seq <= appliedSeq(op.replica); }
+
+    Record* live(const OpId& element) {
+        auto it = elements.find(element);
+        return it == elements.end() || it->second.removed ? nullptr : &it->second;
+    }
+
+    void apply(const Operation& op) {
+        clock = max(clock, op.lamport);
+        applied[op.id.replica] = op.id.seq;
+        Scene& scene = document.getScene();
+        if (op.kind == OpKind::Create) {
+            Record r{-1, op.element, op.type, op.coord, op.lamport, op.id.replica, false};
+            if (op.element == "Graph") {
+                // Same command a local createGraph runs, but kept off the local undo stack
+                CreateGraphCommand cmd(&graphs, &scene, op.type, op.coord);
+                cmd.execute();
+                r.sceneId = cmd.element();
+            } else if (op.element == "Figure") {
+                // Straight into the scene like remote graphs, moves and removes: a peer's edit is
+                // neither journaled nor undoable here
+                r.sceneId = scene.add("Figure", op.type, op.coord, make_shared<Figure>(), figures.getFlyweight(op.type));
+            }
+            elements.emplace(op.id, std::move(r));
+            return;
+        }
+        Record* r = live(op.target);
+        if (!r) return;
+        if (op.kind == OpKind::Remove) {
+            r->removed = true;
+            if (r->sceneId >= 0) scene.remove(r->sceneId);
+            r->sceneId = -1;
+            return;
+        }
+        // Last writer wins; ties on the clock go to the higher replica id
+        if (op.lamport < r->lamport || (op.lamport == r->lamport && op.id.replica < r->writer)) return;
+        r->lamport = op.lamport;
+        r->writer = op.id.replica;
+        r->coord = op.coord;
+        if (r->sceneId >= 0) scene.move(r->sceneId, op.coord);
+    }
+
+    Operation local(OpKind kind) {
+        Operation op;
+        op.kind = kind;
+        op.id = {self, ++seq};
+        op.lamport = ++clock;
+        return op;
+    }
+
+    void publish(Operation op) {
+        apply(op);
+        outgoing.push_back(std::move(op));
+    }
+
+    // Applies every waiting op whose predecessor and target have arrived, until nothing moves
+    size_t drain() {
+        size_t count = 0;
+        for (bool progress = true; progress;) {
+            progress = false;
+            for (auto it = waiting.begin(); it != waiting.end();) {
+                auto& queue = it->second;
+                uint64_t next = appliedSeq(it->first) + 1;
+                while (!queue.empty() && queue.begin()->first <= next) {
+                    auto head = queue.begin();
+                    if (head->first == next) {
+                        const Operation& op = head->second;
+                        if (op.kind != OpKind::Create && !delivered(op.target)) break;
+                        apply(op);
+                        ++next;
+                        ++count;
+                        progress = true;
+                    }
+                    queue.erase(head);
+                    --waitingCount;
+                }
+                if (queue.empty()) it = waiting.erase(it);
+                else ++it;
+            }
+        }
+        return count;
+    }
+};
+
+Replica::Replica(uint32_t id, DiagramFactory& document) : impl(make_unique<Impl>(id, document)) {}
+
+Replica::~Replica() = default;
+
+OpId Replica::create(string element, string type, string coord) {
+    Operation op = impl->local(OpKind::Create);
+    op.element = std::move(element);
+    op.type = std::move(type);
+    op.coord = std::move(coord);
+    OpId id = op.id;
+    impl->publish(std::move(op));
+    return id;
+}
+
+bool Replica::move(OpId element, string coord) {
+    if (!impl->live(element)) return false;
+    Operation op = impl->local(OpKind::Move);
+    op.target = element;
+    op.coord = std::move(coord);
+    impl->publish(std::move(op));
+    return true;
+}
+
+bool Replica::remove(OpId element) {
+    if (!impl->live(element)) return false;
+    Operation op = impl->local(OpKind::Remove);
+    op.target = element;
+    impl->publish(std::move(op));
+    return true;
+}
+
+string Replica::takeOutgoing() {
+    if (impl->outgoing.empty()) return {};
+    string batch = encodeOps(impl->outgoing);
+    impl->outgoing.clear();
+    return batch;
+}
+
+long Replica::merge(const string& batch) {
+    DIAGRAM_TRACE_SCOPE("collab", "Replica::merge");
+    vector<Operation> ops;
+    if (!decodeOps(batch, ops)) return -1;
+    for (auto& op : ops) {
+        if (impl->delivered(op.id)) continue;
+        if (impl->waiting[op.id.replica].emplace(op.id.seq, std::move(op)).second) ++impl->waitingCount;
+    }
+    return (long)impl->drain();
+}
+
+size_t Replica::pending() const { return impl->waitingCount; }
+
+int Replica::sceneId(OpId element) const {
+    auto* r = impl->live(element);
+    return r ? r->sceneId : -1;
+}
+
+uint64_t Replica::stateHash() const {
+    vector<pair<OpId, const Impl::Record*>> live;
+    for (auto& e : impl->elements)
+        if (!e.second.removed) live.push_back({e.first, &e.second});
+    sort(live.begin(), live.end(), [](auto& a, auto& b) { return a.first < b.first; });
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](const void* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) h = (h ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+    };
+    for (auto& e : live) {
+        mix(&e.first.replica, sizeof e.first.replica);
+        mix(&e.first.seq, sizeof e.first.seq);
+        for (auto* s : {&e.second->element, &e.second->type, &e.second->coord}) mix(s->c_str(), s->size() + 1);
+    }
+    return h;
+}
+
+} // namespace diagram
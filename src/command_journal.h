@@ -0,0 +1,213 @@
+// Internal - record format, group commit and replay for the command journal.
+#ifndef DIAGRAM_COMMAND_JOURNAL_H
+#define DIAGRAM_COMMAND_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "diagram/journal.h"
+
+namespace diagram {
+
+// History records re-seed the undo/redo stacks right after a snapshot, so the journal
+// plus its snapshot always describe both the scene and its history
+enum JournalOp : uint8_t {
+    OpCreateGraph = 1, OpCreateFigure = 2, OpUndo = 3, OpRedo = 4,
+    OpHistoryUndo = 5, OpHistoryRedo = 6
+};
+
+// Record: [u32 payload size][u32 FNV-1a of payload][payload: op, varint sequence, field count,
+// varint-prefixed fields]. Sequence numbers keep rising across truncations, so a snapshot can
+// record the last one it covers and replay can skip records it already holds
+class CommandJournal {
+    int fd = -1;
+    uint64_t nextSeq = 1;
+    std::string pending;
+    size_t pendingRecords = 0;
+    size_t committedRecords = 0;
+    JournalOptions options;
+
+    static uint32_t checksum(const char* data, size_t size) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < size; ++i) h = (h ^ (unsigned char)data[i]) * 16777619u;
+        return h;
+    }
+    static void putVarint(std::string& outBuf, uint64_t v) {
+        while (v >= 0x80) {
+            outBuf.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        outBuf.push_back((char)v);
+    }
+    static bool getVarint(const char*& p, const char* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            unsigned char b = (unsigned char)*p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    static void putU32(std::string& outBuf, uint32_t v) {
+        for (int i = 0; i < 4; ++i) outBuf.push_back((char)(v >> (8 * i)));
+    }
+    static uint32_t getU32(const char* p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)(unsigned char)p[i] << (8 * i);
+        return v;
+    }
+    static bool writeAll(int file, const char* data, size_t size) {
+        while (size > 0) {
+            auto n = ::write(file, data, (unsigned)size);
+            if (n <= 0) return false;
+            data += n;
+            size -= (size_t)n;
+        }
+        return true;
+    }
+    static void syncFile(int file) {
+#ifdef _WIN32
+        _commit(file);
+#else
+        fsync(file);
+#endif
+    }
+public:
+    // Flushes a written file, and the directory entry a rename made, to stable storage
+    static bool syncPath(const std::string& path) {
+#ifdef _WIN32
+        int file = ::_open(path.c_str(), _O_RDONLY);
+        if (file < 0) return false;
+        bool ok = _commit(file) == 0;
+        ::_close(file);
+        return ok;
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        bool ok = fsync(file) == 0;
+        ::close(file);
+        return ok;
+#endif
+    }
+    static bool syncDirectoryOf(const std::string& path) {
+#ifdef _WIN32
+        (void)path;
+        return true;  // directory entries cannot be flushed separately
+#else
+        auto slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        return syncPath(dir);
+#endif
+    }
+
+    CommandJournal() = default;
+    CommandJournal(const CommandJournal&) = delete;
+    CommandJournal& operator=(const CommandJournal&) = delete;
+    ~CommandJournal() { close(); }
+
+    bool open(const std::string& path, JournalOptions opts) {
+        close();
+        options = opts;
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        return fd >= 0;
+    }
+    void close() {
+        if (fd < 0) return;
+        commit();
+        ::close(fd);
+        fd = -1;
+    }
+    bool isOpen() const { return fd >= 0; }
+    bool durable() const { return options.fsync != FsyncPolicy::Never; }
+    // Numbers the next record after seq, e.g. after replaying up to it
+    void continueAfter(uint64_t seq) { nextSeq = seq + 1; }
+    // Sequence number of the last appended record (0 if none)
+    uint64_t lastSeq() const { return nextSeq - 1; }
+
+    void append(JournalOp op, const std::vector<std::string>& fields = {}) {
+        if (fd < 0) return;
+        std::string payload(1, (char)op);
+        putVarint(payload, nextSeq++);
+        putVarint(payload, fields.size());
+        for (auto& f : fields) {
+            putVarint(payload, f.size());
+            payload += f;
+        }
+        putU32(pending, (uint32_t)payload.size());
+        putU32(pending, checksum(payload.data(), payload.size()));
+        pending += payload;
+        ++pendingRecords;
+        if (options.fsync == FsyncPolicy::EveryRecord || pendingRecords >= options.batchSize) commit();
+    }
+    // Group commit - one write (and at most one fsync) for every buffered record
+    bool commit() {
+        if (fd < 0 || pending.empty()) return true;
+        bool ok = writeAll(fd, pending.data(), pending.size());
+        if (ok && options.fsync != FsyncPolicy::Never) syncFile(fd);
+        committedRecords += pendingRecords;
+        pending.clear();
+        pendingRecords = 0;
+        return ok;
+    }
+    bool snapshotDue() const {
+        return options.snapshotInterval > 0 && committedRecords >= options.snapshotInterval;
+    }
+    // Called once a snapshot covering every committed record is durable
+    bool truncate(const std::string& path) {
+        commit();
+        if (fd >= 0) ::close(fd);
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        return fd >= 0;
+    }
+    // Restarts the snapshot interval; records written so far are covered by the snapshot
+    void markSnapshotted() { committedRecords = 0; }
+
+    // Replays intact records in order as apply(op, seq, fields); a torn or corrupt tail (crash
+    // mid-write) ends replay
+    template <typename Fn>
+    static size_t replay(const std::string& path, Fn apply) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return 0;
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const char* p = data.data();
+        const char* end = p + data.size();
+        size_t applied = 0;
+        while (end - p >= 8) {
+            uint32_t size = getU32(p), sum = getU32(p + 4);
+            if ((size_t)(end - p - 8) < size || checksum(p + 8, size) != sum || size == 0) break;
+            const char* q = p + 8;
+            const char* recordEnd = q + size;
+            JournalOp op = (JournalOp)*q++;
+            uint64_t seq, count, len;
+            if (!getVarint(q, recordEnd, seq) || !getVarint(q, recordEnd, count) || count > size) break;
+            std::vector<std::string> fields;
+            bool intact = true;
+            for (uint64_t i = 0; i < count && intact; ++i) {
+                intact = getVarint(q, recordEnd, len) && (uint64_t)(recordEnd - q) >= len;
+                if (intact) {
+                    fields.emplace_back(q, (size_t)len);
+                    q += len;
+                }
+            }
+            if (!intact) break;
+            apply(op, seq, fields);
+            ++applied;
+            p = recordEnd;
+        }
+        return applied;
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_COMMAND_JOURNAL_H
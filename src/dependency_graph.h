@@ -0,0 +1,47 @@
+// Internal - edges from shared scene inputs to the elements whose layout reads them.
+#ifndef DIAGRAM_DEPENDENCY_GRAPH_H
+#define DIAGRAM_DEPENDENCY_GRAPH_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "diagram/persistent.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+// Dependency Tracking - Edges from shared inputs (data series, axis groups) to dependent elements;
+// persistent, so scene versions share it
+class DependencyGraph {
+    struct Edge { int id; SceneInput input; };
+    PersistentMap<std::string, std::vector<Edge>> dependents;
+public:
+    void link(const std::string& source, int id, SceneInput input) {
+        if (auto* edges = dependents.find(source))
+            for (auto& e : *edges) if (e.id == id && e.input == input) return;
+        dependents.edit(source).push_back({id, input});
+    }
+    void unlink(const std::string& source, int id) {
+        auto* edges = dependents.mutate(source);
+        if (!edges) return;
+        edges->erase(std::remove_if(edges->begin(), edges->end(), [id](const Edge& e) { return e.id == id; }), edges->end());
+        if (edges->empty()) dependents.erase(source);
+    }
+    template <typename Fn>
+    void forEachDependent(const std::string& source, Fn fn) const {
+        auto* edges = dependents.find(source);
+        if (!edges) return;
+        for (auto& e : *edges) fn(e.id, e.input);
+    }
+    void freeze() { dependents.freeze(); }
+    DependencyGraph share() const {
+        DependencyGraph copy;
+        copy.dependents = dependents.share();
+        return copy;
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_DEPENDENCY_GRAPH_H
@@ -0,0 +1,217 @@
+#include "diagram/diagram_factory.h"
+#include "diagram/command.h"
+#include "diagram/flyweight.h"
+#include "diagram/instrumentation.h"
+#include "diagram/registry.h"
+#include "diagram/scene_file.h"
+#include "command_journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+namespace diagram {
+
+// Everything a document mutates lives here; only immutable figure geometry is shared
+struct DiagramFactory::Impl {
+    GraphFactory graphFactory;
+    FigureFactory figureFactory;
+    Scene scene;
+    Undo undoManager;
+    Redo redoManager;
+    HistoryMode mode = HistoryMode::Commands;
+    VersionHistory versions;
+    shared_ptr<DrawSubscriber> regSub = make_shared<RegSub>();
+    shared_ptr<DrawSubscriber> contrastSub = make_shared<ContrastImageSub>();
+    CommandJournal journal;
+    string journalPath, snapshotPath;
+    uint64_t snapshotSeq = 0;  // last journal record the loaded snapshot covers
+};
+
+DiagramFactory::DiagramFactory() : impl(make_unique<Impl>()) {}
+
+DiagramFactory::~DiagramFactory() = default;
+
+static void journaled(DiagramFactory& df, CommandJournal& journal, JournalOp op, const vector<string>& fields = {}) {
+    if (!journal.isOpen()) return;
+    journal.append(op, fields);
+    if (journal.snapshotDue()) df.checkpoint();
+}
+
+static void journalHistory(CommandJournal& journal, JournalOp op, const vector<shared_ptr<Command>>& cmds) {
+    for (auto& cmd : cmds) {
+        auto create = dynamic_pointer_cast<CreateGraphCommand>(cmd);
+        if (create) journal.append(op, {create->graphType(), create->graphCoord(), to_string(create->element())});
+    }
+}
+
+int DiagramFactory::createGraph(string type, string coord) {
+    auto cmd = make_shared<CreateGraphCommand>(&impl->graphFactory, &impl->scene, type, coord);
+    cmd->execute();
+    if (impl->mode == HistoryMode::Versions) {
+        impl->versions.record(impl->scene.snapshot());
+    } else {
+        impl->undoManager.addCommand(cmd);
+        impl->redoManager.clear();
+    }
+    journaled(*this, impl->journal, OpCreateGraph, {type, coord});
+    return cmd->element();
+}
+
+int DiagramFactory::createFigure(string type, string coord) {
+    auto fig = impl->figureFactory.getFigure(type, coord, impl->regSub);
+    fig->attachSubscriber(impl->contrastSub);
+    int id = impl->scene.add("Figure", type, coord, make_shared<Figure>(), fig);
+    if (impl->mode == HistoryMode::Versions) impl->versions.record(impl->scene.snapshot());
+    // Journaled once the scene holds the figure, since the append may trigger a checkpoint
+    journaled(*this, impl->journal, OpCreateFigure, {type, coord});
+    return id;
+}
+
+int DiagramFactory::getDiagram(string element, string type, string coord) {
+    DIAGRAM_TRACE_SCOPE("factory", "DiagramFactory::getDiagram");
+    return TypeRegistry::getInstance().makeElement(*this, element, type, coord);
+}
+
+void DiagramFactory::setHistoryMode(HistoryMode mode) {
+    impl->mode = mode;
+    impl->undoManager = Undo();
+    impl->redoManager.clear();
+    if (mode == HistoryMode::Versions) impl->versions.reset(impl->scene.snapshot());
+}
+
+HistoryMode DiagramFactory::historyMode() const { return impl->mode; }
+
+void DiagramFactory::undo(size_t steps) {
+    DIAGRAM_TRACE_SCOPE("history", "undo");
+    if (impl->mode == HistoryMode::Versions) {
+        size_t taken = impl->versions.undo(steps);
+        if (taken == 0) return;
+        impl->scene.restore(impl->versions.current());
+        journaled(*this, impl->journal, OpUndo, {to_string(taken)});
+        return;
+    }
+    for (size_t i = 0; i < steps; ++i) {
+        auto cmd = impl->undoManager.popCommand();
+        if (!cmd) break;
+        cmd->undo();
+        impl->redoManager.addCommand(cmd);
+        journaled(*this, impl->journal, OpUndo);
+    }
+}
+
+void DiagramFactory::redo(size_t steps) {
+    DIAGRAM_TRACE_SCOPE("history", "redo");
+    if (impl->mode == HistoryMode::Versions) {
+        size_t taken = impl->versions.redo(steps);
+        if (taken == 0) return;
+        impl->scene.restore(impl->versions.current());
+        journaled(*this, impl->journal, OpRedo, {to_string(taken)});
+        return;
+    }
+    for (size_t i = 0; i < steps; ++i) {
+        auto cmd = impl->redoManager.popCommand();
+        if (!cmd) break;
+        cmd->execute();
+        impl->undoManager.addCommand(cmd);
+        journaled(*this, impl->journal, OpRedo);
+    }
+}
+
+Scene& DiagramFactory::getScene() { return impl->scene; }
+
+bool DiagramFactory::save(const string& path) { return writeSceneFile(impl->scene, path); }
+
+bool DiagramFactory::load(const string& path) {
+    auto view = SceneView::open(path);
+    if (!view) return false;
+    impl->snapshotSeq = view->journalSeq();
+    Scene& scene = impl->scene;
+    for (size_t i = 0; i < view->seriesCount(); ++i) {
+        const double* data = view->seriesData(i);
+        if (data) scene.updateSeries(view->str(view->series(i).name), vector<double>(data, data + view->series(i).count));
+    }
+    for (size_t i = 0; i < view->elementCount(); ++i) {
+        auto& r = view->element(i);
+        int id;
+        if (r.kind == KindGraph) {
+            id = scene.add("Graph", view->str(r.type), view->str(r.coord), make_shared<Graph>(), nullptr, r.id);
+        } else {
+            auto fig = impl->figureFactory.getFlyweight(view->str(r.type));
+            fig->attachSubscriber(impl->regSub);
+            fig->attachSubscriber(impl->contrastSub);
+            id = scene.add("Figure", view->str(r.type), view->str(r.coord), make_shared<Figure>(), fig, r.id);
+        }
+        if (r.style != kNoString) scene.setStyle(id, view->str(r.style));
+        if (r.series != kNoString) scene.bindSeries(id, view->str(r.series));
+        if (r.axisGroup != kNoString) {
+            scene.linkAxis(id, view->str(r.axisGroup));
+            scene.setAxis(view->str(r.axisGroup), {r.axisMin, r.axisMax, r.axisAuto != 0});
+        }
+    }
+    return true;
+}
+
+bool DiagramFactory::enableJournal(const string& journalFile, const string& snapshotFile, JournalOptions options) {
+    // Recovery rebuilds the whole document; anything already here would be duplicated and journaled
+    if (impl->journal.isOpen() || impl->scene.size() != 0 || !impl->undoManager.empty() ||
+        !impl->redoManager.empty() || impl->versions.size() > 1)
+        return false;
+    impl->journalPath = journalFile;
+    impl->snapshotPath = snapshotFile;
+    impl->snapshotSeq = 0;
+    QuietOutput quiet;
+    load(impl->snapshotPath);
+    // The snapshot is the base every replayed undo steps back towards
+    if (impl->mode == HistoryMode::Versions) impl->versions.reset(impl->scene.snapshot());
+    // Records at or below the snapshot's sequence are already in it: a crash between writing the
+    // snapshot and truncating the journal leaves them behind
+    uint64_t lastSeq = impl->snapshotSeq;
+    CommandJournal::replay(impl->journalPath, [&](JournalOp op, uint64_t seq, const vector<string>& f) {
+        if (seq <= impl->snapshotSeq) return;
+        lastSeq = max(lastSeq, seq);
+        if (op == OpCreateGraph && f.size() == 2) createGraph(f[0], f[1]);
+        else if (op == OpCreateFigure && f.size() == 2) createFigure(f[0], f[1]);
+        else if (op == OpUndo) undo(f.empty() ? 1 : (size_t)atoi(f[0].c_str()));
+        else if (op == OpRedo) redo(f.empty() ? 1 : (size_t)atoi(f[0].c_str()));
+        else if ((op == OpHistoryUndo || op == OpHistoryRedo) && f.size() == 3) {
+            auto cmd = make_shared<CreateGraphCommand>(&impl->graphFactory, &impl->scene, f[0], f[1], atoi(f[2].c_str()));
+            if (op == OpHistoryUndo) impl->undoManager.addCommand(cmd);
+            else impl->redoManager.addCommand(cmd);
+        }
+    });
+    if (!impl->journal.open(impl->journalPath, options)) return false;
+    impl->journal.continueAfter(lastSeq);
+    // Fold the replayed history into a fresh snapshot so the journal starts empty
+    return checkpoint();
+}
+
+bool DiagramFactory::flushJournal() { return impl->journal.commit(); }
+
+bool DiagramFactory::checkpoint() {
+    CommandJournal& journal = impl->journal;
+    if (!journal.isOpen() || !journal.commit()) return false;
+    // The snapshot is durable before it replaces the old one, and its rename is durable before
+    // the journal it covers is truncated; a crash in between replays only records past covered
+    uint64_t covered = journal.lastSeq();
+    string temp = impl->snapshotPath + ".tmp";
+    if (!writeSceneFile(impl->scene, temp, covered)) return false;
+    if (journal.durable() && !CommandJournal::syncPath(temp)) return false;
+#ifdef _WIN32
+    std::remove(impl->snapshotPath.c_str());
+#endif
+    if (std::rename(temp.c_str(), impl->snapshotPath.c_str()) != 0) return false;
+    // Recovery can only step back as far as the snapshot, so live history must not go further
+    if (impl->mode == HistoryMode::Versions) impl->versions.reset(impl->scene.snapshot());
+    if (journal.durable() && !CommandJournal::syncDirectoryOf(impl->snapshotPath)) return false;
+    if (!journal.truncate(impl->journalPath)) return false;
+    journalHistory(journal, OpHistoryUndo, impl->undoManager.contents());
+    journalHistory(journal, OpHistoryRedo, impl->redoManager.contents());
+    bool ok = journal.commit();
+    journal.markSnapshotted();
+    return ok;
+}
+
+} // namespace diagram
@@ -0,0 +1,39 @@
+#include "diagram/elements.h"
+#include "diagram/instrumentation.h"
+#include "notify.h"
+
+using namespace std;
+
+namespace diagram {
+
+void ExportVisitor::visit(Graph*) {
+    DIAGRAM_TRACE_SCOPE("visitor", "exportGraph");
+    out() << "Exporting Graph as PNG...\n";
+}
+
+void ExportVisitor::visit(Figure*) {
+    DIAGRAM_TRACE_SCOPE("visitor", "exportFigure");
+    out() << "Exporting Figure as JPG...\n";
+}
+
+void Graph::notifySubscribers(const string& msg) {
+    DIAGRAM_TIME_STAGE(StageNotify);
+    deliver(subscribers, msg);
+}
+
+void Figure::notifySubscribers(const string& msg) {
+    DIAGRAM_TIME_STAGE(StageNotify);
+    deliver(subscribers, msg);
+}
+
+void DrawGraph::draw() {
+    DIAGRAM_TRACE_SCOPE("proxy", "DrawGraph::draw");
+    out() << "[Graph Proxy] Drawing graphical + textual stub\n";
+}
+
+Task<> ExportVisitor::exportAsync(shared_ptr<Diagram> diagram) {
+    co_await Executor::getInstance().schedule(Priority::Low);
+    diagram->accept(this);
+}
+
+} // namespace diagram
@@ -0,0 +1,303 @@
+#include "diagram/executor.h"
+#include "diagram/output.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace diagram {
+
+struct Executor::Impl {
+    struct Worker {
+        mutex lock;
+        array<deque<function<void()>>, kPriorityCount> queues;
+        atomic<size_t> size{0};  // lets thieves skip empty workers without locking
+        int cpu = -1;
+        size_t node = 0;
+        vector<size_t> victims;  // same-node workers first, then remote ones
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    vector<vector<size_t>> workersOnNode;
+    vector<size_t> nodeOfCpu;
+    atomic<size_t> queued{0}, placement{0};
+    atomic<int> sleepers{0};
+    atomic<bool> stopping{false};
+    mutex idleLock;
+    condition_variable idle;
+
+    // Index of the worker the calling thread is, if it is one
+    static thread_local Impl* owner;
+    static thread_local size_t self;
+
+    // Linux: one worker per allowed CPU, grouped by the nodes listed in sysfs
+    void discoverTopology() {
+        vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof allowed, &allowed) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        for (int node = 0;; ++node) {
+            ifstream list("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+            if (!list) break;
+            string range;
+            while (getline(list, range, ',')) {
+                int first = -1, last = -1;
+                char dash;
+                istringstream parse(range);
+                if (!(parse >> first)) continue;
+                if (!(parse >> dash >> last)) last = first;
+                for (int c = first; c <= last; ++c) {
+                    if ((size_t)c >= nodeOfCpu.size()) nodeOfCpu.resize((size_t)c + 1, 0);
+                    nodeOfCpu[(size_t)c] = (size_t)node;
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) cpus.assign(max(1u, thread::hardware_concurrency()), -1);
+        // DIAGRAM_THREADS overrides the pool size, e.g. to share a machine with other services;
+        // workers then cycle over the allowed CPUs
+        size_t count = cpus.size();
+        if (const char* env = getenv("DIAGRAM_THREADS"))
+            if (atoi(env) > 0) count = (size_t)atoi(env);
+        for (size_t i = 0; i < count; ++i) {
+            int c = cpus[i % cpus.size()];
+            auto w = make_unique<Worker>();
+            w->cpu = c;
+            w->node = c >= 0 && (size_t)c < nodeOfCpu.size() ? nodeOfCpu[(size_t)c] : 0;
+            if (w->node >= workersOnNode.size()) workersOnNode.resize(w->node + 1);
+            workersOnNode[w->node].push_back(workers.size());
+            workers.push_back(std::move(w));
+        }
+        // Compact away nodes that have no allowed CPUs
+        vector<size_t> compacted(workersOnNode.size(), 0);
+        size_t used = 0;
+        for (size_t n = 0; n < workersOnNode.size(); ++n) {
+            if (workersOnNode[n].empty()) continue;
+            compacted[n] = used;
+            for (size_t id : workersOnNode[n]) workers[id]->node = used;
+            if (used != n) workersOnNode[used] = std::move(workersOnNode[n]);
+            ++used;
+        }
+        workersOnNode.resize(used);
+        for (auto& node : nodeOfCpu) node = node < compacted.size() ? compacted[node] : 0;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            auto& victims = workers[i]->victims;
+            for (size_t k = 1; k < workers.size(); ++k) {
+                size_t v = (i + k) % workers.size();
+                if (workers[v]->node == workers[i]->node) victims.push_back(v);
+            }
+            for (size_t k = 1; k < workers.size(); ++k) {
+                size_t v = (i + k) % workers.size();
+                if (workers[v]->node != workers[i]->node) victims.push_back(v);
+            }
+        }
+    }
+
+    size_t currentNode() const {
+#ifdef __linux__
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t)cpu < nodeOfCpu.size() && nodeOfCpu[(size_t)cpu] < workersOnNode.size())
+            return nodeOfCpu[(size_t)cpu];
+#endif
+        return 0;
+    }
+
+    void push(size_t target, function<void()> job, Priority priority) {
+        Worker& w = *workers[target];
+        {
+            lock_guard<mutex> guard(w.lock);
+            w.queues[(int)priority].push_back(std::move(job));
+        }
+        w.size.fetch_add(1);
+        queued.fetch_add(1);
+        if (sleepers.load() > 0) {
+            lock_guard<mutex> guard(idleLock);
+            idle.notify_one();
+        }
+    }
+
+    bool popOwn(Worker& w, function<void()>& job) {
+        if (w.size.load(memory_order_relaxed) == 0) return false;
+        lock_guard<mutex> guard(w.lock);
+        for (auto& q : w.queues) {
+            if (q.empty()) continue;
+            job = std::move(q.back());
+            q.pop_back();
+            w.size.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    bool steal(Worker& w, int priority, function<void()>& job) {
+        if (w.size.load(memory_order_relaxed) == 0) return false;
+        lock_guard<mutex> guard(w.lock);
+        auto& q = w.queues[priority];
+        if (q.empty()) return false;
+        job = std::move(q.front());
+        q.pop_front();
+        w.size.fetch_sub(1);
+        return true;
+    }
+
+    // Jobs report failures to their own completion state (parallelFor chunks to their call,
+    // coroutines to their promise), so nothing may escape into whichever thread runs them
+    static void runJob(function<void()>& job) noexcept { job(); }
+
+    // One job from our own deques, else the highest-priority job any other worker holds
+    bool runOne() {
+        function<void()> job;
+        bool found = false;
+        if (owner == this) {
+            Worker& mine = *workers[self];
+            found = popOwn(mine, job);
+            for (int p = 0; p < kPriorityCount && !found; ++p)
+                for (size_t v : mine.victims)
+                    if ((found = steal(*workers[v], p, job))) break;
+        } else {
+            const auto& local = workersOnNode[currentNode()];
+            for (int p = 0; p < kPriorityCount && !found; ++p) {
+                for (size_t v : local)
+                    if ((found = steal(*workers[v], p, job))) break;
+                for (size_t v = 0; v < workers.size() && !found; ++v) found = steal(*workers[v], p, job);
+            }
+        }
+        if (!found) return false;
+        queued.fetch_sub(1);
+        runJob(job);
+        return true;
+    }
+
+    void workerLoop(size_t index) {
+        owner = this;
+        self = index;
+#ifdef __linux__
+        if (workersOnNode.size() > 1 && workers[index]->cpu >= 0) {
+            cpu_set_t only;
+            CPU_ZERO(&only);
+            CPU_SET(workers[index]->cpu, &only);
+            pthread_setaffinity_np(pthread_self(), sizeof only, &only);
+        }
+#endif
+        for (;;) {
+            if (runOne()) continue;
+            if (queued.load() == 0) {
+                // Going idle: hand buffered stub output to the sink rather than hold it indefinitely
+                flushOutput();
+            }
+            unique_lock<mutex> guard(idleLock);
+            sleepers.fetch_add(1);
+            idle.wait(guard, [&] { return queued.load() > 0 || stopping.load(); });
+            sleepers.fetch_sub(1);
+            if (stopping.load() && queued.load() == 0) return;
+        }
+    }
+};
+
+thread_local Executor::Impl* Executor::Impl::owner = nullptr;
+thread_local size_t Executor::Impl::self = 0;
+
+Executor::Executor() : impl(make_unique<Impl>()) {
+    // Pool threads flush into Output on exit, so it has to outlive this singleton
+    Output::getInstance();
+    impl->discoverTopology();
+    for (size_t i = 0; i < impl->workers.size(); ++i) impl->threads.emplace_back([this, i] { impl->workerLoop(i); });
+}
+
+Executor::~Executor() {
+    {
+        lock_guard<mutex> guard(impl->idleLock);
+        impl->stopping = true;
+    }
+    impl->idle.notify_all();
+    for (auto& t : impl->threads) t.join();
+}
+
+Executor& Executor::getInstance() {
+    static Executor instance;
+    return instance;
+}
+
+void Executor::post(function<void()> job, Priority priority) {
+    size_t target;
+    if (Impl::owner == impl.get()) {
+        target = Impl::self;
+    } else {
+        const auto& local = impl->workersOnNode[impl->currentNode()];
+        target = local[impl->placement.fetch_add(1, memory_order_relaxed) % local.size()];
+    }
+    impl->push(target, std::move(job), priority);
+}
+
+size_t Executor::threads() const { return impl->workers.size(); }
+
+size_t Executor::numaNodes() const { return impl->workersOnNode.size(); }
+
+void Executor::parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& fn, Priority priority) {
+    if (count == 0) return;
+    grain = max<size_t>(grain, 1);
+    size_t chunks = min((count + grain - 1) / grain, threads() * 4);
+    if (chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    chunks = (count + chunkSize - 1) / chunkSize;
+    // Helpers that start after every chunk is claimed return without touching fn. A chunk that
+    // throws still counts as done, so the caller never waits forever; the first exception is
+    // kept and the chunks not yet started are skipped
+    struct Progress {
+        atomic<size_t> next{0}, done{0};
+        atomic<bool> failed{false};
+        mutex errorLock;
+        exception_ptr error;
+
+        void fail(exception_ptr e) {
+            lock_guard<mutex> guard(errorLock);
+            if (!error) error = std::move(e);
+            failed.store(true, memory_order_relaxed);
+        }
+    };
+    auto progress = make_shared<Progress>();
+    auto work = [progress, &fn, count, chunks, chunkSize] {
+        for (size_t c; (c = progress->next.fetch_add(1)) < chunks;) {
+            if (!progress->failed.load(memory_order_relaxed)) {
+                try {
+                    fn(c * chunkSize, min(count, (c + 1) * chunkSize));
+                } catch (...) {
+                    progress->fail(current_exception());
+                }
+            }
+            progress->done.fetch_add(1, memory_order_release);
+        }
+    };
+    size_t helpers = min(chunks, threads()) - 1;
+    for (size_t i = 0; i < helpers; ++i) post(work, priority);
+    work();
+    // Other chunks are still running: help with whatever is queued instead of blocking. Jobs
+    // run here keep their failures to themselves, so only this call's chunks are rethrown
+    while (progress->done.load(memory_order_acquire) < chunks)
+        if (!impl->runOne()) this_thread::yield();
+    if (progress->error) rethrow_exception(progress->error);
+}
+
+} // namespace diagram
@@ -0,0 +1,165 @@
+#include "diagram/flyweight.h"
+#include "diagram/executor.h"
+#include "diagram/instrumentation.h"
+#include "diagram/registry.h"
+#include "notify.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace diagram {
+
+// Scanline fill with 4 sub-scanlines per pixel row and fractional span ends
+static CoverageMask scanlineMask(const vector<pair<float, float>>& poly, int size) {
+    const int kSub = 4;
+    CoverageMask m;
+    m.size = size;
+    m.coverage.assign((size_t)size * size, 0);
+    vector<float> accum(size);
+    vector<float> xs;
+    for (int row = 0; row < size; ++row) {
+        fill(accum.begin(), accum.end(), 0.0f);
+        for (int sub = 0; sub < kSub; ++sub) {
+            float y = (row + (sub + 0.5f) / kSub) / size;
+            xs.clear();
+            for (size_t i = 0; i < poly.size(); ++i) {
+                auto a = poly[i], b = poly[(i + 1) % poly.size()];
+                if ((a.second <= y) != (b.second <= y))
+                    xs.push_back(a.first + (y - a.second) / (b.second - a.second) * (b.first - a.first));
+            }
+            sort(xs.begin(), xs.end());
+            for (size_t i = 0; i + 1 < xs.size(); i += 2) {
+                float l = xs[i] * size, r = xs[i + 1] * size;
+                for (int col = max(0, (int)l); col < min(size, (int)ceil(r)); ++col)
+                    accum[col] += max(0.0f, min(r, col + 1.0f) - max(l, (float)col));
+            }
+        }
+        for (int col = 0; col < size; ++col)
+            m.coverage[(size_t)row * size + col] = (unsigned char)min(255.0f, accum[col] / kSub * 255.0f + 0.5f);
+    }
+    return m;
+}
+
+// Below this many mask pixels a batch is blitted on the calling thread
+static constexpr size_t kParallelRasterPixels = 1 << 18;
+static constexpr size_t kRowsPerBand = 16;
+
+CoverageMask FigureGeometry::maskAt(int pixels) const { return scanlineMask(outline, pixels); }
+
+void FlyweightFigure::rasterize(const float* xs, const float* ys, size_t count, int pixelSize, Canvas& canvas,
+                                unsigned char shade) {
+    if (pixelSize <= 0 || count == 0) return;
+    // Off-cache sizes are rasterized once per batch, not per instance
+    CoverageMask uncached;
+    const CoverageMask* cached = geometry().cachedMask(pixelSize);
+    if (!cached) uncached = geometry().maskAt(pixelSize);
+    const CoverageMask& mask = cached ? *cached : uncached;
+    if (count * (size_t)mask.size * (size_t)mask.size < kParallelRasterPixels) {
+        for (size_t i = 0; i < count; ++i)
+            canvas.blit(mask.coverage.data(), mask.size, (int)xs[i], (int)ys[i], shade);
+        return;
+    }
+    // Compositing is a max(), so bands give the same pixels as the serial loop in any order
+    Executor::getInstance().parallelFor((size_t)canvas.height(), kRowsPerBand, [&](size_t r0, size_t r1) {
+        for (size_t i = 0; i < count; ++i)
+            canvas.blit(mask.coverage.data(), mask.size, (int)xs[i], (int)ys[i], shade, (int)r0, (int)r1);
+    });
+}
+
+FigureGeometry FigureGeometry::build(const string& type) {
+    FigureGeometry g;
+    int sides = 4;
+    if (type.find("Circle") != string::npos) sides = 48;
+    else if (type.find("Triangle") != string::npos) sides = 3;
+    const double pi = 3.14159265358979323846;
+    double start = sides == 4 ? pi / 4 : -pi / 2;
+    double radius = sides == 4 ? sqrt(0.5) : 0.5;
+    for (int i = 0; i < sides; ++i) {
+        double a = start + 2 * pi * i / sides;
+        g.outline.push_back({(float)(0.5 + radius * cos(a)), (float)(0.5 + radius * sin(a))});
+    }
+    for (int size : kMaskScales) g.masks.push_back(scanlineMask(g.outline, size));
+    return g;
+}
+
+shared_ptr<const FigureGeometry> FigureGeometry::shared(const string& type) {
+    static constexpr size_t kShards = 16;
+    struct Shard {
+        mutex lock;
+        unordered_map<string, shared_ptr<const FigureGeometry>> geometry;
+    };
+    static array<Shard, kShards> shards;
+    Shard& shard = shards[hash<string>{}(type) % kShards];
+    lock_guard<mutex> guard(shard.lock);
+    auto& g = shard.geometry[type];
+    if (!g) g = make_shared<const FigureGeometry>(build(type));
+    return g;
+}
+
+// Shared by both concrete flyweights: idempotent attach, and notification from a snapshot
+// taken under the lock with expired subscribers pruned
+static void attachWeak(vector<weak_ptr<DrawSubscriber>>& subscribers, mutex& lock, shared_ptr<DrawSubscriber> sub) {
+    lock_guard<mutex> guard(lock);
+    for (auto& s : subscribers)
+        if (s.lock() == sub) return;
+    subscribers.push_back(sub);
+}
+
+static void notifyWeak(vector<weak_ptr<DrawSubscriber>>& subscribers, mutex& lock, const string& msg) {
+    DIAGRAM_TIME_STAGE(StageNotify);
+    vector<shared_ptr<DrawSubscriber>> snapshot;
+    {
+        lock_guard<mutex> guard(lock);
+        subscribers.erase(remove_if(subscribers.begin(), subscribers.end(),
+                                    [](const weak_ptr<DrawSubscriber>& s) { return s.expired(); }),
+                          subscribers.end());
+        for (auto& s : subscribers)
+            if (auto live = s.lock()) snapshot.push_back(live);
+    }
+    deliver(snapshot, msg);
+}
+
+void ColoredFigure::attachSubscriber(shared_ptr<DrawSubscriber> sub) { attachWeak(subscribers, subscribersLock, sub); }
+void ColoredFigure::notifySubscribers(const string& msg) { notifyWeak(subscribers, subscribersLock, msg); }
+void BWFigure::attachSubscriber(shared_ptr<DrawSubscriber> sub) { attachWeak(subscribers, subscribersLock, sub); }
+void BWFigure::notifySubscribers(const string& msg) { notifyWeak(subscribers, subscribersLock, msg); }
+
+shared_ptr<FlyweightFigure> FlyweightFactory::getFigure(string type) {
+    Shard& shard = shards[hash<string>{}(type) % kShards];
+    lock_guard<mutex> guard(shard.lock);
+    auto& fig = shard.pool[type];
+    if (!fig) fig = TypeRegistry::getInstance().makeFigure(type);
+    if (!fig) {
+        // Unregistered types: the name decides
+        if (type.find("Color") != string::npos)
+            fig = make_shared<ColoredFigure>(type);
+        else
+            fig = make_shared<BWFigure>(type);
+    }
+    return fig;
+}
+
+FigureFactory& FigureFactory::getInstance() {
+    static FigureFactory instance(true);
+    return instance;
+}
+
+shared_ptr<FlyweightFigure> FigureFactory::lookup(const string& type) {
+    if (!threadCached) return flyFactory.getFigure(type);
+    thread_local unordered_map<string, shared_ptr<FlyweightFigure>> cache;
+    auto it = cache.find(type);
+    if (it != cache.end()) return it->second;
+    return cache[type] = flyFactory.getFigure(type);
+}
+
+shared_ptr<FlyweightFigure> FigureFactory::getFigure(string type, string coord, shared_ptr<DrawSubscriber> sub) {
+    DIAGRAM_TRACE_SCOPE("factory", "FigureFactory::getFigure");
+    auto fig = lookup(type);
+    fig->attachSubscriber(sub);
+    out() << "Coordinates: " << coord << "\n";
+    fig->draw();
+    return fig;
+}
+
+} // namespace diagram
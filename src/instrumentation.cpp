@@ -0,0 +1,188 @@
+#include "diagram/instrumentation.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+namespace diagram {
+
+const char* stageName(Stage s) {
+    static const char* names[kStageCount] = {"construct", "setCoord", "calc", "draw", "drag", "notify", "render", "serve"};
+    return names[s];
+}
+
+// Log-linear (HDR-style) latency histogram in nanoseconds: exact below 32 ns, then 32
+// sub-buckets per power of two (~3% relative error) up to 2^64 ns.
+// Each thread owns its histograms and is the only writer, so recording is a relaxed
+// load/store with no lock or read-modify-write; dumps read concurrently. Zeroing a count
+// from another thread could be undone by a record in flight, so reset() instead moves a
+// baseline that reads subtract; counts themselves are never written by other threads.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 5;
+    static constexpr uint64_t kSub = 1ull << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+private:
+    array<atomic<uint64_t>, kBuckets> counts{};
+    array<uint64_t, kBuckets> baseline{};  // counts at the last reset; guarded by Instrumentation::lock
+public:
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < kSub) return (size_t)ns;
+        int shift = 63 - __builtin_clzll(ns) - kSubBits;
+        return (size_t)((shift + 1) * kSub + ((ns >> shift) - kSub));
+    }
+    static uint64_t lowerBound(size_t bucket) {
+        if (bucket < 2 * kSub) return bucket;
+        uint64_t shift = bucket / kSub - 1;
+        return (kSub + bucket % kSub) << shift;
+    }
+    void record(uint64_t ns) {
+        auto& c = counts[bucketOf(ns)];
+        c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    void addTo(vector<uint64_t>& merged) const {
+        for (size_t i = 0; i < kBuckets; ++i) merged[i] += counts[i].load(memory_order_relaxed) - baseline[i];
+    }
+    void clear() {
+        for (size_t i = 0; i < kBuckets; ++i) baseline[i] = counts[i].load(memory_order_relaxed);
+    }
+};
+
+struct Instrumentation::ThreadStages {
+    array<LatencyHistogram, kStageCount> stages;
+};
+
+Instrumentation& Instrumentation::getInstance() {
+    static Instrumentation instance;
+    return instance;
+}
+
+Instrumentation::ThreadStages& Instrumentation::local() {
+    thread_local shared_ptr<ThreadStages> mine = [this] {
+        auto t = make_shared<ThreadStages>();
+        lock_guard<mutex> guard(lock);
+        threads.push_back(t);
+        return t;
+    }();
+    return *mine;
+}
+
+void Instrumentation::record(Stage stage, uint64_t ns) { local().stages[stage].record(ns); }
+
+vector<uint64_t> Instrumentation::merged(Stage stage) {
+    vector<uint64_t> all(LatencyHistogram::kBuckets, 0);
+    lock_guard<mutex> guard(lock);
+    for (auto& t : threads) t->stages[stage].addTo(all);
+    return all;
+}
+
+uint64_t Instrumentation::percentile(const vector<uint64_t>& buckets, double q) {
+    uint64_t total = 0;
+    for (auto c : buckets) total += c;
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * total), seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= max<uint64_t>(rank, 1)) return LatencyHistogram::lowerBound(i);
+    }
+    return LatencyHistogram::lowerBound(buckets.size() - 1);
+}
+
+void Instrumentation::dump(ostream& os) {
+    os << left << setw(12) << "stage" << right << setw(12) << "count" << setw(12) << "p50(ns)"
+       << setw(12) << "p99(ns)" << setw(12) << "p999(ns)" << "\n";
+    for (int s = 0; s < kStageCount; ++s) {
+        auto buckets = merged((Stage)s);
+        uint64_t count = 0;
+        for (auto c : buckets) count += c;
+        if (count == 0) continue;
+        os << left << setw(12) << stageName((Stage)s) << right << setw(12) << count
+           << setw(12) << percentile(buckets, 0.50) << setw(12) << percentile(buckets, 0.99)
+           << setw(12) << percentile(buckets, 0.999) << "\n";
+    }
+}
+
+void Instrumentation::reset() {
+    lock_guard<mutex> guard(lock);
+    for (auto& t : threads)
+        for (auto& h : t->stages) h.clear();
+}
+
+struct Tracer::ThreadRing {
+    mutex lock;  // taken by the owning thread per event and by dumps, so practically uncontended
+    vector<TraceEvent> events;
+    size_t next = 0, written = 0;
+    int tid;
+    explicit ThreadRing(int id) : tid(id) {}
+};
+
+Tracer& Tracer::getInstance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::ThreadRing& Tracer::local() {
+    thread_local shared_ptr<ThreadRing> mine = [this] {
+        lock_guard<mutex> guard(lock);
+        auto r = make_shared<ThreadRing>((int)rings.size() + 1);
+        r->events.resize(ringCapacity);
+        rings.push_back(r);
+        return r;
+    }();
+    return *mine;
+}
+
+void Tracer::enable(size_t eventsPerThread) {
+    {
+        lock_guard<mutex> guard(lock);
+        ringCapacity = max<size_t>(eventsPerThread, 1);
+    }
+    enabled.store(true, memory_order_relaxed);
+}
+
+void Tracer::record(const char* category, const char* name, uint64_t beginNs, uint64_t endNs) {
+    ThreadRing& r = local();
+    lock_guard<mutex> guard(r.lock);
+    r.events[r.next] = {category, name, beginNs, endNs - beginNs};
+    r.next = (r.next + 1) % r.events.size();
+    ++r.written;
+}
+
+void Tracer::dumpChromeJson(ostream& os) {
+    lock_guard<mutex> guard(lock);
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto sep = [&] { os << (first ? "\n" : ",\n"); first = false; };
+    os << fixed << setprecision(3);
+    for (auto& r : rings) {
+        lock_guard<mutex> ringGuard(r->lock);
+        sep();
+        os << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << r->tid
+           << ",\"args\":{\"name\":\"thread " << r->tid << "\"}}";
+        size_t size = r->events.size();
+        size_t count = min(r->written, size);
+        size_t start = r->written > size ? r->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto& e = r->events[(start + i) % size];
+            sep();
+            os << "{\"ph\":\"X\",\"cat\":\"" << e.category << "\",\"name\":\"" << e.name
+               << "\",\"pid\":1,\"tid\":" << r->tid << ",\"ts\":" << e.beginNs / 1000.0
+               << ",\"dur\":" << e.durationNs / 1000.0 << "}";
+        }
+    }
+    os << "\n]}\n";
+    os.unsetf(ios::floatfield);
+}
+
+void Tracer::clear() {
+    lock_guard<mutex> guard(lock);
+    for (auto& r : rings) {
+        lock_guard<mutex> ringGuard(r->lock);
+        r->next = r->written = 0;
+    }
+}
+
+} // namespace diagram
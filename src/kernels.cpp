@@ -0,0 +1,314 @@
+#include "diagram/kernels.h"
+#include "diagram/executor.h"
+#include "diagram/instrumentation.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace diagram {
+
+// Values per parallel chunk; below this a pass runs on the calling thread
+static constexpr size_t kGrain = size_t(1) << 16;
+// Values whose bin indices are computed together before the scattered increments
+static constexpr size_t kBlock = 1024;
+
+// False for NaN and infinities, without a branch
+static inline bool finite(double v) { return v - v == 0; }
+
+// Branch-free clamp of a scaled value to [0, last], NaN to 0; keeps the index loops vectorizable
+static inline int clampIndex(double scaled, int last) {
+    scaled = scaled >= 0 ? scaled : 0;
+    scaled = scaled <= last ? scaled : last;
+    return (int)scaled;
+}
+
+// Maps [min, max] onto [0, cells). Works on halved values, so a range wider than the largest
+// double still has a finite width; a single-valued range maps to the flat position
+struct BinScale {
+    double lo = 0, scale = 0, base = 0;
+    BinScale(ValueRange range, int cells, double flat) : lo(range.min * 0.5) {
+        double width = range.max * 0.5 - lo;
+        if (width > 0) scale = cells / width;
+        else base = flat;
+    }
+    double operator()(double v) const { return base + (v * 0.5 - lo) * scale; }
+};
+
+// Non-finite values get index `last + 1`, a discard slot one past the real bins
+static void binIndices(const double* __restrict v, size_t n, const BinScale& at, int last, int* __restrict out) {
+    for (size_t i = 0; i < n; ++i) out[i] = finite(v[i]) ? clampIndex(at(v[i]), last) : last + 1;
+}
+
+static void cellIndices(const double* __restrict xs, const double* __restrict ys, size_t n, const BinScale& atX,
+                        const BinScale& atY, int width, int height, int* __restrict out) {
+    int discard = width * height;
+    for (size_t i = 0; i < n; ++i) {
+        int cell = clampIndex(atY(ys[i]), height - 1) * width + clampIndex(atX(xs[i]), width - 1);
+        out[i] = finite(xs[i]) && finite(ys[i]) ? cell : discard;
+    }
+}
+
+ValueRange valueRange(const double* values, size_t n) {
+    const double inf = numeric_limits<double>::infinity();
+    ValueRange total{inf, -inf};
+    mutex merge;
+    Executor::getInstance().parallelFor(n, kGrain, [&](size_t begin, size_t end) {
+        // Independent accumulators so the comparisons pipeline
+        double lo[4] = {inf, inf, inf, inf};
+        double hi[4] = {-inf, -inf, -inf, -inf};
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+            for (int k = 0; k < 4; ++k) {
+                double v = values[i + k];
+                lo[k] = finite(v) && v < lo[k] ? v : lo[k];
+                hi[k] = finite(v) && v > hi[k] ? v : hi[k];
+            }
+        for (; i < end; ++i) {
+            lo[0] = finite(values[i]) && values[i] < lo[0] ? values[i] : lo[0];
+            hi[0] = finite(values[i]) && values[i] > hi[0] ? values[i] : hi[0];
+        }
+        double chunkLo = min(min(lo[0], lo[1]), min(lo[2], lo[3]));
+        double chunkHi = max(max(hi[0], hi[1]), max(hi[2], hi[3]));
+        lock_guard<mutex> guard(merge);
+        total.min = min(total.min, chunkLo);
+        total.max = max(total.max, chunkHi);
+    });
+    return total.min <= total.max ? total : ValueRange{};
+}
+
+Histogram histogram(const double* values, size_t n, size_t bins) {
+    DIAGRAM_TRACE_SCOPE("kernel", "histogram");
+    Histogram h;
+    if (bins == 0) return h;
+    h.counts.assign(bins, 0);
+    if (n == 0) return h;
+    h.range = valueRange(values, n);
+    BinScale at(h.range, (int)bins, (double)(bins / 2));
+    int last = (int)bins - 1;
+    mutex merge;
+    Executor::getInstance().parallelFor(n, kGrain, [&](size_t begin, size_t end) {
+        vector<uint64_t> partial(bins + 1, 0);
+        int index[kBlock];
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t count = min(kBlock, end - b);
+            binIndices(values + b, count, at, last, index);
+            for (size_t i = 0; i < count; ++i) ++partial[(size_t)index[i]];
+        }
+        lock_guard<mutex> guard(merge);
+        for (size_t i = 0; i < bins; ++i) h.counts[i] += partial[i];
+    });
+    return h;
+}
+
+DensityGrid splat(const double* xs, const double* ys, const double* weights, size_t n, int width, int height) {
+    DIAGRAM_TRACE_SCOPE("kernel", "splat");
+    DensityGrid g;
+    if (width <= 0 || height <= 0) return g;
+    g.width = width;
+    g.height = height;
+    size_t cells = (size_t)width * height;
+    g.cells.assign(cells, 0);
+    if (n == 0) return g;
+    ValueRange rx = valueRange(xs, n), ry = valueRange(ys, n);
+    g.area = {rx.min, ry.min, rx.max, ry.max};
+    BinScale atX(rx, width, 0), atY(ry, height, 0);
+    mutex merge;
+    Executor::getInstance().parallelFor(n, kGrain, [&](size_t begin, size_t end) {
+        vector<double> partial(cells + 1, 0);
+        int index[kBlock];
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t count = min(kBlock, end - b);
+            cellIndices(xs + b, ys + b, count, atX, atY, width, height, index);
+            if (weights) {
+                for (size_t i = 0; i < count; ++i) partial[(size_t)index[i]] += weights[b + i];
+            } else {
+                for (size_t i = 0; i < count; ++i) partial[(size_t)index[i]] += 1;
+            }
+        }
+        lock_guard<mutex> guard(merge);
+        for (size_t i = 0; i < cells; ++i) g.cells[i] += partial[i];
+    });
+    g.peak = *max_element(g.cells.begin(), g.cells.end());
+    return g;
+}
+
+AreaProfile areaProfile(const double* xs, const double* ys, size_t n, int columns) {
+    DIAGRAM_TRACE_SCOPE("kernel", "areaProfile");
+    AreaProfile p;
+    if (n == 0 || columns <= 0) return p;
+    p.x = valueRange(xs, n);
+    p.y = valueRange(ys, n);
+    BinScale at(p.x, columns, 0);
+    const double empty = -numeric_limits<double>::infinity();
+    p.envelope.assign((size_t)columns, empty);
+    mutex merge;
+    Executor::getInstance().parallelFor(n, kGrain, [&](size_t begin, size_t end) {
+        // Segment i joins points i and i+1, so the chunk's last segment reads one point past it
+        size_t segments = min(end, n - 1);
+        double area = 0;
+        for (size_t i = begin; i < segments; ++i) {
+            double segment = 0.5 * (ys[i] + ys[i + 1]) * (xs[i + 1] - xs[i]);
+            area += finite(xs[i]) && finite(xs[i + 1]) && finite(ys[i]) && finite(ys[i + 1]) ? segment : 0;
+        }
+        vector<double> partial((size_t)columns + 1, empty);
+        int index[kBlock];
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t count = min(kBlock, end - b);
+            binIndices(xs + b, count, at, columns - 1, index);
+            for (size_t i = 0; i < count; ++i) {
+                size_t c = finite(ys[b + i]) ? (size_t)index[i] : (size_t)columns;
+                partial[c] = max(partial[c], ys[b + i]);
+            }
+        }
+        lock_guard<mutex> guard(merge);
+        p.area += area;
+        for (size_t c = 0; c < p.envelope.size(); ++c) p.envelope[c] = max(p.envelope[c], partial[c]);
+    });
+    // Columns no point fell into continue the previous column
+    double carry = p.y.min;
+    for (auto& v : p.envelope) {
+        if (v == empty) v = carry;
+        carry = v;
+    }
+    return p;
+}
+
+// splitmix64 finalizer: every output bit depends on every key bit. A bare multiply leaves the
+// low bits weak, so keys that are multiples of 2^k would pile onto a few slots
+static inline uint64_t hashKey(int64_t key) {
+    uint64_t h = (uint64_t)key + 0x9E3779B97F4A7C15ull;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+// Aggregation - Open-addressing table of per-group partials; the top hash bits pick the
+// partition and the low bits the slot. The hash is fully mixed, so keys sharing a partition
+// still spread over the slots
+class GroupTable {
+    vector<int64_t> keys;
+    vector<uint8_t> used;
+    size_t size = 0;
+
+    void grow() {
+        GroupTable bigger(keys.size() * 2);
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (used[i]) bigger.add(bigger.slot(keys[i], hashKey(keys[i])), counts[i], sums[i], mins[i], maxs[i]);
+        *this = std::move(bigger);
+    }
+public:
+    vector<uint64_t> counts;
+    vector<double> sums, mins, maxs;
+
+    explicit GroupTable(size_t capacity = 16)
+        : keys(capacity), used(capacity, 0), counts(capacity, 0), sums(capacity, 0),
+          mins(capacity, numeric_limits<double>::infinity()), maxs(capacity, -numeric_limits<double>::infinity()) {}
+
+    // The key's slot, claimed if the key is new; kept at most half full
+    size_t slot(int64_t key, uint64_t h) {
+        if ((size + 1) * 2 > keys.size()) grow();
+        size_t mask = keys.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            if (!used[i]) {
+                used[i] = 1;
+                keys[i] = key;
+                ++size;
+                return i;
+            }
+            if (keys[i] == key) return i;
+        }
+    }
+    void add(size_t i, uint64_t count, double sum, double lo, double hi) {
+        counts[i] += count;
+        sums[i] += sum;
+        mins[i] = min(mins[i], lo);
+        maxs[i] = max(maxs[i], hi);
+    }
+    void mergeFrom(const GroupTable& other) {
+        for (size_t i = 0; i < other.keys.size(); ++i)
+            if (other.used[i]) add(slot(other.keys[i], hashKey(other.keys[i])), other.counts[i], other.sums[i], other.mins[i], other.maxs[i]);
+    }
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (used[i]) fn(keys[i], i);
+    }
+    size_t groups() const { return size; }
+};
+
+static constexpr unsigned kPartitionBits = 6;
+static constexpr size_t kPartitions = size_t(1) << kPartitionBits;
+using PartitionedTables = array<GroupTable, kPartitions>;
+
+GroupedValues aggregate(const int64_t* keys, const double* values, size_t n, const AggregationSpec& spec) {
+    DIAGRAM_TRACE_SCOPE("kernel", "aggregate");
+    GroupedValues result;
+    if (n == 0 || !keys) return result;
+
+    // Phase 1: every chunk aggregates its rows into its own partitioned tables
+    vector<unique_ptr<PartitionedTables>> partials;
+    mutex collect;
+    Executor& executor = Executor::getInstance();
+    executor.parallelFor(n, kGrain, [&](size_t begin, size_t end) {
+        auto tables = make_unique<PartitionedTables>();
+        uint64_t hashes[kBlock];
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t count = min(kBlock, end - b);
+            for (size_t i = 0; i < count; ++i) hashes[i] = hashKey(keys[b + i]);
+            for (size_t i = 0; i < count; ++i) {
+                GroupTable& t = (*tables)[hashes[i] >> (64 - kPartitionBits)];
+                double v = values ? values[b + i] : 0;
+                t.add(t.slot(keys[b + i], hashes[i]), 1, v, v, v);
+            }
+        }
+        lock_guard<mutex> guard(collect);
+        partials.push_back(std::move(tables));
+    });
+
+    // Phase 2: partitions hold disjoint keys, so each is merged by one job with no locking
+    PartitionedTables merged;
+    executor.parallelFor(kPartitions, 1, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p)
+            for (auto& chunk : partials) merged[p].mergeFrom((*chunk)[p]);
+    });
+
+    size_t groups = 0;
+    for (auto& t : merged) groups += t.groups();
+    vector<pair<int64_t, double>> bars;
+    bars.reserve(groups);
+    for (auto& t : merged) {
+        t.forEach([&](int64_t key, size_t i) {
+            double v = 0;
+            switch (spec.fn) {
+            case Aggregate::Count: v = (double)t.counts[i]; break;
+            case Aggregate::Sum: v = t.sums[i]; break;
+            case Aggregate::Mean: v = t.sums[i] / (double)t.counts[i]; break;
+            case Aggregate::Min: v = t.mins[i]; break;
+            case Aggregate::Max: v = t.maxs[i]; break;
+            }
+            bars.push_back({key, v});
+        });
+    }
+    if (spec.topN > 0) {
+        auto larger = [](auto& a, auto& b) { return a.second != b.second ? a.second > b.second : a.first < b.first; };
+        size_t kept = min(spec.topN, bars.size());
+        partial_sort(bars.begin(), bars.begin() + (ptrdiff_t)kept, bars.end(), larger);
+        bars.resize(kept);
+    } else {
+        sort(bars.begin(), bars.end());
+    }
+    result.keys.reserve(bars.size());
+    result.values.reserve(bars.size());
+    for (auto& b : bars) {
+        result.keys.push_back(b.first);
+        result.values.push_back(b.second);
+    }
+    return result;
+}
+
+} // namespace diagram
@@ -0,0 +1,31 @@
+// Internal - observer fan-out shared by graphs, figures and flyweights.
+#ifndef DIAGRAM_NOTIFY_H
+#define DIAGRAM_NOTIFY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "diagram/elements.h"
+#include "diagram/executor.h"
+
+namespace diagram {
+
+// Fan-outs this large are spread over the Executor; subscribers then run concurrently
+// and in no particular order, so their notify() must be thread-safe (the built-ins are).
+// Part of the attachSubscriber contract, see DrawSubscriber
+constexpr size_t kParallelFanOut = 256;
+
+inline void deliver(const std::vector<std::shared_ptr<DrawSubscriber>>& subscribers, const std::string& msg) {
+    if (subscribers.size() < kParallelFanOut) {
+        for (auto& s : subscribers) s->notify(msg);
+        return;
+    }
+    Executor::getInstance().parallelFor(subscribers.size(), kParallelFanOut / 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) subscribers[i]->notify(msg);
+    });
+}
+
+} // namespace diagram
+
+#endif // DIAGRAM_NOTIFY_H
@@ -0,0 +1,78 @@
+#include "diagram/output.h"
+
+#include <iostream>
+
+using namespace std;
+
+namespace diagram {
+
+void StreamSink::write(const char* data, size_t size) {
+    lock_guard<mutex> guard(lock);
+    stream.write(data, (streamsize)size);
+}
+
+void StreamSink::flush() {
+    lock_guard<mutex> guard(lock);
+    stream.flush();
+}
+
+Output::Output() : active(make_shared<StreamSink>(cout)) {}
+
+Output& Output::getInstance() {
+    static Output instance;
+    return instance;
+}
+
+shared_ptr<OutputSink> Output::sink() const {
+    lock_guard<mutex> guard(lock);
+    return active;
+}
+
+void Output::setSink(shared_ptr<OutputSink> s) {
+    flushOutput();
+    lock_guard<mutex> guard(lock);
+    active = s ? s : make_shared<NullSink>();
+    generation.fetch_add(1, memory_order_release);
+}
+
+void OutputBuffer::flushLines() {
+    size_t end = buffer.rfind('\n');
+    if (end == string::npos) return;
+    Output::getInstance().sink()->write(buffer.data(), end + 1);
+    buffer.erase(0, end + 1);
+}
+
+void OutputBuffer::flush() {
+    auto sink = Output::getInstance().sink();
+    if (!buffer.empty()) sink->write(buffer.data(), buffer.size());
+    buffer.clear();
+    sink->flush();
+}
+
+static OutputBuffer& threadOutput() {
+    thread_local OutputBuffer buffer;
+    return buffer;
+}
+
+static thread_local unsigned quietDepth = 0;
+
+QuietOutput::QuietOutput() { ++quietDepth; }
+
+QuietOutput::~QuietOutput() { --quietDepth; }
+
+OutputWriter out() {
+    if (quietDepth > 0) return OutputWriter(nullptr);
+    thread_local unsigned seen = ~0u;
+    thread_local bool discarding = false;
+    Output& output = Output::getInstance();
+    unsigned current = output.version();
+    if (current != seen) {
+        seen = current;
+        discarding = output.sink()->discards();
+    }
+    return OutputWriter(discarding ? nullptr : &threadOutput());
+}
+
+void flushOutput() { threadOutput().flush(); }
+
+} // namespace diagram
@@ -0,0 +1,251 @@
+#include "diagram/registry.h"
+#include "diagram/diagram_factory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace diagram {
+
+// Hazard Pointers - Each thread that looks a name up owns one slot where it publishes the table
+// it is reading. Slots are never freed, only handed to the next thread once their owner exits,
+// so the list needs no destruction order; it grows to the most threads that ever read at once
+struct HazardSlot {
+    atomic<const void*> table{nullptr};
+    atomic<bool> claimed{true};
+    HazardSlot* next = nullptr;
+};
+static atomic<HazardSlot*> hazardSlots{nullptr};
+
+static HazardSlot* claimSlot() {
+    for (HazardSlot* s = hazardSlots.load(memory_order_acquire); s; s = s->next) {
+        bool unclaimed = false;
+        if (s->claimed.compare_exchange_strong(unclaimed, true)) return s;
+    }
+    auto* s = new HazardSlot;
+    s->next = hazardSlots.load(memory_order_relaxed);
+    while (!hazardSlots.compare_exchange_weak(s->next, s, memory_order_release, memory_order_relaxed)) {}
+    return s;
+}
+
+struct SlotLease {
+    HazardSlot* slot = claimSlot();
+    ~SlotLease() { slot->claimed.store(false, memory_order_release); }
+};
+
+// The plain pointer keeps the lookup path free of the lease's thread-local init guard
+static HazardSlot& threadSlot() {
+    thread_local HazardSlot* mine = nullptr;
+    if (!mine) {
+        thread_local SlotLease lease;
+        mine = lease.slot;
+    }
+    return *mine;
+}
+
+// Asymmetric Fence - A reader's slot store has to be visible before it re-checks the table, and
+// to the writer before it frees one. On Linux the rare writer forces a full barrier on every
+// running thread of the process with membarrier, so the lookup path needs only a compiler
+// fence; elsewhere, or if the kernel refuses, both sides issue a real fence
+static bool lightReaders() {
+#ifdef __linux__
+    static const bool registered = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+    return registered;
+#else
+    return false;
+#endif
+}
+
+static inline void readerFence() {
+    if (lightReaders()) atomic_signal_fence(memory_order_seq_cst);
+    else atomic_thread_fence(memory_order_seq_cst);
+}
+
+static void writerFence() {
+#ifdef __linux__
+    // Cannot fail once registered
+    if (lightReaders()) {
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+        return;
+    }
+#endif
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// One kind of name: its tables are immutable once published. A lookup publishes the table it
+// reads in its thread's hazard slot; a registration retires the table it replaces and frees
+// every retired table no slot still names, so only tables mid-lookup outlive their successor.
+// Makers are copied out before running, so lookups never nest and one slot per thread suffices
+template <typename Maker>
+class Dispatch {
+    using Table = PerfectHashTable<Maker>;
+    atomic<const Table*> current;
+    unique_ptr<const Table> live;
+    vector<unique_ptr<const Table>> retired;
+public:
+    // Publishes the current table in the thread's slot and clears it when destroyed. The slot is
+    // stored before the pointer is re-checked and the writer scans slots after publishing, with
+    // the fences between, so a retired table no slot names has no reader left
+    class Pin {
+        HazardSlot& slot;
+        const Table* table;
+    public:
+        explicit Pin(const Dispatch& d) : slot(threadSlot()), table(d.current.load(memory_order_relaxed)) {
+            for (;;) {
+                slot.table.store(table, memory_order_relaxed);
+                readerFence();
+                const Table* again = d.current.load(memory_order_acquire);
+                if (again == table) break;
+                table = again;
+            }
+        }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        ~Pin() { slot.table.store(nullptr, memory_order_release); }
+        const Table* operator->() const { return table; }
+    };
+
+    Dispatch() : live(make_unique<const Table>()) { current.store(live.get(), memory_order_release); }
+    Pin read() const { return Pin(*this); }
+    // Caller holds the registry lock
+    bool add(string name, Maker make) {
+        if (live->find(name) >= 0) return false;
+        auto entries = live->list();
+        entries.push_back({std::move(name), std::move(make)});
+        retired.push_back(std::move(live));
+        live = make_unique<const Table>(std::move(entries));
+        current.store(live.get(), memory_order_release);
+        writerFence();
+        vector<const void*> reading;
+        for (HazardSlot* s = hazardSlots.load(memory_order_acquire); s; s = s->next)
+            if (const void* t = s->table.load(memory_order_acquire)) reading.push_back(t);
+        retired.erase(remove_if(retired.begin(), retired.end(), [&](const unique_ptr<const Table>& t) {
+            return find(reading.begin(), reading.end(), t.get()) == reading.end();
+        }), retired.end());
+        return true;
+    }
+};
+
+struct TypeRegistry::Impl {
+    mutex lock;
+    Dispatch<BuilderMaker> graphs;
+    Dispatch<FigureMaker> figures;
+    Dispatch<ElementMaker> elements;
+    vector<void*> plugins;
+};
+
+template <typename T>
+static TypeRegistry::BuilderMaker builderOf() {
+    return [] { return unique_ptr<Builder>(make_unique<T>()); };
+}
+
+// Built-in types are registered here rather than self-registered, so they exist whatever the
+// link or static-initialization order
+TypeRegistry::TypeRegistry() : impl(make_unique<Impl>()) {
+    registerGraph("Bar", builderOf<BarBuilder>());
+    registerGraph("Line", builderOf<LineBuilder>());
+    registerGraph("Scatter", builderOf<ScatterBuilder>());
+    registerGraph("Area", builderOf<AreaBuilder>());
+    registerGraph("Histogram", builderOf<HistogramBuilder>());
+    registerGraph("Heatmap", builderOf<HeatmapBuilder>());
+    registerElement("Graph", [](DiagramFactory& df, const string& type, const string& coord) {
+        return df.createGraph(type, coord);
+    });
+    registerElement("Figure", [](DiagramFactory& df, const string& type, const string& coord) {
+        return df.createFigure(type, coord);
+    });
+}
+
+TypeRegistry::~TypeRegistry() = default;
+
+TypeRegistry& TypeRegistry::getInstance() {
+    static TypeRegistry instance;
+    return instance;
+}
+
+bool TypeRegistry::registerGraph(string type, BuilderMaker make) {
+    lock_guard<mutex> guard(impl->lock);
+    return impl->graphs.add(std::move(type), std::move(make));
+}
+
+bool TypeRegistry::registerFigure(string type, FigureMaker make) {
+    lock_guard<mutex> guard(impl->lock);
+    return impl->figures.add(std::move(type), std::move(make));
+}
+
+bool TypeRegistry::registerElement(string element, ElementMaker make) {
+    lock_guard<mutex> guard(impl->lock);
+    return impl->elements.add(std::move(element), std::move(make));
+}
+
+int TypeRegistry::graphSlot(string_view type) const { return impl->graphs.read()->find(type); }
+
+unique_ptr<Builder> TypeRegistry::makeBuilder(int slot) const {
+    BuilderMaker make;
+    {
+        auto table = impl->graphs.read();
+        if (slot < 0 || (size_t)slot >= table->size()) return nullptr;
+        make = table->at(slot).value;
+    }
+    return make();
+}
+
+shared_ptr<FlyweightFigure> TypeRegistry::makeFigure(const string& type) const {
+    FigureMaker make;
+    {
+        auto table = impl->figures.read();
+        int i = table->find(type);
+        if (i < 0) return nullptr;
+        make = table->at(i).value;
+    }
+    return make(type);
+}
+
+int TypeRegistry::makeElement(DiagramFactory& factory, const string& element, const string& type,
+                              const string& coord) const {
+    ElementMaker make;
+    {
+        auto table = impl->elements.read();
+        int i = table->find(element);
+        if (i < 0) return -1;
+        make = table->at(i).value;
+    }
+    return make(factory, type, coord);
+}
+
+bool TypeRegistry::loadPlugin(const string& path, string* error) {
+#ifdef _WIN32
+    if (error) *error = "plugins are not supported on this platform";
+    return false;
+#else
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        if (error) *error = dlerror();
+        return false;
+    }
+    using Entry = void (*)(TypeRegistry&);
+    auto entry = (Entry)dlsym(handle, "diagram_register_types");
+    if (!entry) {
+        if (error) *error = "no diagram_register_types in " + path;
+        dlclose(handle);
+        return false;
+    }
+    entry(*this);
+    lock_guard<mutex> guard(impl->lock);
+    impl->plugins.push_back(handle);
+    return true;
+#endif
+}
+
+} // namespace diagram
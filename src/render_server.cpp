@@ -0,0 +1,422 @@
+#include "diagram/render_server.h"
+#include "diagram/diagram_factory.h"
+#include "diagram/executor.h"
+#include "diagram/instrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace diagram {
+
+using Clock = chrono::steady_clock;
+
+static constexpr int kMaxImageSide = 4096;
+static constexpr size_t kMaxItems = 100000;
+static constexpr size_t kMaxLine = 1 << 20;
+
+static string trim(const string& s) {
+    size_t b = s.find_first_not_of(" \t\r"), e = s.find_last_not_of(" \t\r");
+    return b == string::npos ? "" : s.substr(b, e - b + 1);
+}
+
+bool parseRenderRequest(const string& line, RenderRequest& request, string& error) {
+    request = RenderRequest();
+    size_t bar = line.find('|');
+    istringstream head(line.substr(0, bar));
+    string verb;
+    if (!(head >> verb) || verb != "RENDER") {
+        error = "expected RENDER";
+        return false;
+    }
+    if (!(head >> request.width >> request.height >> request.centerX >> request.centerY
+               >> request.viewWidth >> request.viewHeight)) {
+        error = "expected <width> <height> <centerX> <centerY> <viewWidth> <viewHeight>";
+        return false;
+    }
+    head >> request.budgetMs;
+    if (request.width <= 0 || request.height <= 0 || request.width > kMaxImageSide || request.height > kMaxImageSide) {
+        error = "image size must be 1.." + to_string(kMaxImageSide);
+        return false;
+    }
+    if (request.viewWidth <= 0 || request.viewHeight <= 0 || request.budgetMs < 0) {
+        error = "view size and budget must be positive";
+        return false;
+    }
+    if (bar == string::npos) return true;
+    istringstream items(line.substr(bar + 1));
+    string spec;
+    while (getline(items, spec, ';')) {
+        spec = trim(spec);
+        if (spec.empty()) continue;
+        RenderItem item;
+        istringstream fields(spec);
+        string extra;
+        if (!(fields >> item.element >> item.type >> item.coord) || (fields >> extra)) {
+            error = "expected <element> <type> <coord> in '" + spec + "'";
+            return false;
+        }
+        if (request.items.size() == kMaxItems) {
+            error = "too many items";
+            return false;
+        }
+        request.sceneKey += item.element + ' ' + item.type + ' ' + item.coord + ';';
+        request.items.push_back(std::move(item));
+    }
+    return true;
+}
+
+string encodePgm(const Canvas& canvas) {
+    string header = "P5\n" + to_string(canvas.width()) + " " + to_string(canvas.height()) + "\n255\n";
+    string image;
+    image.reserve(header.size() + canvas.data().size());
+    image += header;
+    image.append((const char*)canvas.data().data(), canvas.data().size());
+    return image;
+}
+
+struct RenderServer::Impl {
+    struct Pending {
+        uint64_t connection;
+        RenderRequest request;
+        Clock::time_point admitted, deadline;
+    };
+    struct Completion {
+        uint64_t connection;
+        string response;
+    };
+    struct Connection {
+        int fd;
+        string input, output;
+        bool awaiting = false;
+    };
+
+    RenderServerOptions options;
+    int listenFd = -1, wakeRead = -1, wakeWrite = -1;
+    atomic<bool> running{false}, ioRunning{false};
+    thread io;
+
+    // Kept in deadline order, so the head is always the most urgent request
+    mutex queueLock;
+    deque<Pending> queue;
+    // Drain jobs on the shared Executor, at most options.workers at a time
+    size_t draining = 0;
+    condition_variable drained;
+    atomic<uint64_t> serviceNs{0};  // moving average per rendered request
+
+    mutex completionLock;
+    vector<Completion> completions;
+
+    atomic<uint64_t> accepted{0}, rejected{0}, expired{0}, rendered{0}, batches{0}, malformed{0}, failed{0};
+
+    explicit Impl(RenderServerOptions o) : options(std::move(o)) {
+        options.workers = max<size_t>(options.workers, 1);
+        options.maxBatch = max<size_t>(options.maxBatch, 1);
+    }
+
+    void complete(uint64_t connection, string response) {
+        {
+            lock_guard<mutex> guard(completionLock);
+            completions.push_back({connection, std::move(response)});
+        }
+        char wake = 1;
+        (void)::write(wakeWrite, &wake, 1);
+    }
+
+    // Admission control - refuse up front rather than queue work that would miss its deadline
+    bool admit(uint64_t connection, RenderRequest request) {
+        auto now = Clock::now();
+        auto budget = request.budgetMs ? chrono::milliseconds(request.budgetMs) : options.latencyBudget;
+        lock_guard<mutex> guard(queueLock);
+        if (!running || queue.size() >= options.maxQueued) return false;
+        // Queued work spread over the pool, plus this request's own service time. An empty
+        // queue always admits, so one slow outlier cannot lock the estimate above every budget.
+        auto predicted = chrono::nanoseconds(serviceNs.load(memory_order_relaxed) * (queue.size() / options.workers + 1));
+        if (!queue.empty() && predicted > budget) return false;
+        Pending p{connection, std::move(request), now, now + budget};
+        auto at = upper_bound(queue.begin(), queue.end(), p.deadline,
+                              [](Clock::time_point d, const Pending& q) { return d < q.deadline; });
+        queue.insert(at, std::move(p));
+        if (draining < options.workers) {
+            ++draining;
+            Executor::getInstance().post([this] { drain(); }, Priority::High);
+        }
+        return true;
+    }
+
+    // Earliest-deadline-first with batching: the most urgent request plus every queued request
+    // for the same scene, so one build (and one set of flyweight lookups) serves them all.
+    // Runs until the queue is empty, then gives its slot back.
+    void drain() {
+        for (;;) {
+            vector<Pending> batch, late;
+            {
+                lock_guard<mutex> guard(queueLock);
+                if (queue.empty()) {
+                    --draining;
+                    drained.notify_all();
+                    return;
+                }
+                auto now = Clock::now();
+                while (!queue.empty() && queue.front().deadline < now) {
+                    late.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+                if (!queue.empty()) {
+                    string key = queue.front().request.sceneKey;
+                    for (auto it = queue.begin(); it != queue.end() && batch.size() < options.maxBatch;) {
+                        if (it->request.sceneKey == key) {
+                            batch.push_back(std::move(*it));
+                            it = queue.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+            }
+            for (auto& p : late) {
+                complete(p.connection, "TIMEOUT\n");
+                expired.fetch_add(1, memory_order_relaxed);
+            }
+            if (batch.empty()) continue;
+            // A failed build or render answers the rest of the batch; the slot is kept either way
+            size_t answered = 0;
+            try {
+                renderBatch(batch, answered);
+            } catch (...) {
+                for (size_t i = answered; i < batch.size(); ++i) complete(batch[i].connection, "ERR render failed\n");
+                failed.fetch_add(batch.size() - answered, memory_order_relaxed);
+            }
+        }
+    }
+
+    // Counts the requests answered so far, so a failure part-way answers only the others
+    void renderBatch(vector<Pending>& batch, size_t& answered) {
+        DIAGRAM_TRACE_SCOPE("server", "renderBatch");
+        auto started = Clock::now();
+        DiagramFactory df;
+        for (auto& item : batch.front().request.items) df.getDiagram(item.element, item.type, item.coord);
+        for (auto& p : batch) {
+            auto& r = p.request;
+            df.viewport() = Viewport(r.centerX, r.centerY, r.viewWidth, r.viewHeight);
+            df.viewport().resizeScreen(r.width, r.height);
+            df.render();
+            string image = encodePgm(df.getScene().lastFrame());
+            complete(p.connection, "OK " + to_string(image.size()) + "\n" + image);
+            ++answered;
+#ifdef DIAGRAM_INSTRUMENT
+            auto served = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - p.admitted);
+            Instrumentation::getInstance().record(StageServe, (uint64_t)served.count());
+#endif
+        }
+        uint64_t perRequest = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - started).count() / batch.size();
+        uint64_t average = serviceNs.load(memory_order_relaxed);
+        serviceNs.store(average ? (average * 7 + perRequest) / 8 : perRequest, memory_order_relaxed);
+        rendered.fetch_add(batch.size(), memory_order_relaxed);
+        batches.fetch_add(1, memory_order_relaxed);
+    }
+
+    static void setNonBlocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+    static void flushConnection(Connection& c) {
+        while (!c.output.empty()) {
+#ifdef MSG_NOSIGNAL
+            auto n = ::send(c.fd, c.output.data(), c.output.size(), MSG_NOSIGNAL);
+#else
+            auto n = ::send(c.fd, c.output.data(), c.output.size(), 0);
+#endif
+            if (n <= 0) return;
+            c.output.erase(0, (size_t)n);
+        }
+    }
+
+    // Answers or admits complete lines until one request is in flight
+    void processInput(uint64_t id, Connection& c) {
+        while (!c.awaiting) {
+            size_t end = c.input.find('\n');
+            if (end == string::npos) {
+                if (c.input.size() > kMaxLine) {
+                    c.output += "ERR line too long\n";
+                    c.input.clear();
+                    malformed.fetch_add(1, memory_order_relaxed);
+                }
+                return;
+            }
+            string line = trim(c.input.substr(0, end));
+            c.input.erase(0, end + 1);
+            if (line.empty()) continue;
+            RenderRequest request;
+            string error;
+            if (!parseRenderRequest(line, request, error)) {
+                c.output += "ERR " + error + "\n";
+                malformed.fetch_add(1, memory_order_relaxed);
+            } else if (admit(id, std::move(request))) {
+                c.awaiting = true;
+                accepted.fetch_add(1, memory_order_relaxed);
+            } else {
+                c.output += "BUSY\n";
+                rejected.fetch_add(1, memory_order_relaxed);
+            }
+        }
+    }
+
+    void ioLoop() {
+        unordered_map<uint64_t, Connection> connections;
+        uint64_t nextConnection = 1;
+        vector<pollfd> fds;
+        vector<uint64_t> ids;
+        for (;;) {
+            bool stopping = !ioRunning.load();
+            fds.clear();
+            ids.clear();
+            fds.push_back({wakeRead, POLLIN, 0});
+            if (!stopping) fds.push_back({listenFd, POLLIN, 0});
+            for (auto& entry : connections) {
+                // A full input buffer is not read further until the pending answer frees it
+                short events = (short)((entry.second.input.size() <= kMaxLine ? POLLIN : 0) |
+                                       (entry.second.output.empty() ? 0 : POLLOUT));
+                fds.push_back({entry.second.fd, events, 0});
+                ids.push_back(entry.first);
+            }
+            if (poll(fds.data(), fds.size(), stopping ? 0 : 100) < 0 && errno != EINTR) break;
+
+            char drain[256];
+            while (::read(wakeRead, drain, sizeof drain) > 0) {}
+            vector<Completion> done;
+            {
+                lock_guard<mutex> guard(completionLock);
+                done.swap(completions);
+            }
+            for (auto& d : done) {
+                auto it = connections.find(d.connection);
+                if (it == connections.end()) continue;  // client went away while queued
+                it->second.output += d.response;
+                it->second.awaiting = false;
+                processInput(it->first, it->second);
+                flushConnection(it->second);
+            }
+
+            size_t first = stopping ? 1 : 2;
+            if (!stopping && (fds[1].revents & POLLIN)) {
+                int fd;
+                while ((fd = ::accept(listenFd, nullptr, nullptr)) >= 0) {
+                    setNonBlocking(fd);
+#ifdef SO_NOSIGPIPE
+                    int one = 1;
+                    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+                    connections[nextConnection++] = Connection{fd, "", "", false};
+                }
+            }
+            for (size_t i = first; i < fds.size(); ++i) {
+                auto it = connections.find(ids[i - first]);
+                if (it == connections.end()) continue;
+                Connection& c = it->second;
+                bool closed = (fds[i].revents & (POLLERR | POLLNVAL)) != 0;
+                if (!closed && (fds[i].revents & (POLLIN | POLLHUP))) {
+                    char buffer[16384];
+                    ssize_t n = 1;
+                    // Bounded even while a request is in flight: a client streaming without a newline
+                    // is held back by the socket instead of growing the buffer
+                    while (c.input.size() <= kMaxLine && (n = ::read(c.fd, buffer, sizeof buffer)) > 0)
+                        c.input.append(buffer, (size_t)n);
+                    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) closed = true;
+                    processInput(it->first, c);
+                }
+                if (!closed) flushConnection(c);
+                if (closed) {
+                    ::close(c.fd);
+                    connections.erase(it);
+                }
+            }
+            if (stopping) break;
+        }
+        for (auto& entry : connections) ::close(entry.second.fd);
+    }
+};
+
+RenderServer::RenderServer(RenderServerOptions options) : impl(make_unique<Impl>(std::move(options))) {}
+
+RenderServer::~RenderServer() { stop(); }
+
+bool RenderServer::start() {
+    if (impl->running) return true;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (impl->options.socketPath.empty() || impl->options.socketPath.size() >= sizeof address.sun_path) return false;
+    memcpy(address.sun_path, impl->options.socketPath.c_str(), impl->options.socketPath.size() + 1);
+
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) return false;
+    impl->wakeRead = pipeFds[0];
+    impl->wakeWrite = pipeFds[1];
+    Impl::setNonBlocking(impl->wakeRead);
+    Impl::setNonBlocking(impl->wakeWrite);
+
+    ::unlink(impl->options.socketPath.c_str());
+    impl->listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (impl->listenFd < 0 || ::bind(impl->listenFd, (sockaddr*)&address, sizeof address) != 0 ||
+        ::listen(impl->listenFd, SOMAXCONN) != 0) {
+        if (impl->listenFd >= 0) ::close(impl->listenFd);
+        ::close(impl->wakeRead);
+        ::close(impl->wakeWrite);
+        impl->listenFd = impl->wakeRead = impl->wakeWrite = -1;
+        return false;
+    }
+    Impl::setNonBlocking(impl->listenFd);
+
+    impl->running = true;
+    impl->ioRunning = true;
+    impl->io = thread([this] { impl->ioLoop(); });
+    return true;
+}
+
+void RenderServer::stop() {
+    if (!impl->running) return;
+    deque<Impl::Pending> refused;
+    {
+        unique_lock<mutex> guard(impl->queueLock);
+        impl->running = false;
+        refused.swap(impl->queue);
+        // Batches already taken finish; their drain jobs then find the queue empty
+        impl->drained.wait(guard, [&] { return impl->draining == 0; });
+    }
+    for (auto& p : refused) impl->complete(p.connection, "BUSY\n");
+    impl->rejected.fetch_add(refused.size(), memory_order_relaxed);
+    // The I/O thread delivers what the drain jobs finished, then closes every connection
+    impl->ioRunning = false;
+    impl->complete(0, "");
+    impl->io.join();
+    ::close(impl->listenFd);
+    ::close(impl->wakeRead);
+    ::close(impl->wakeWrite);
+    impl->listenFd = impl->wakeRead = impl->wakeWrite = -1;
+    ::unlink(impl->options.socketPath.c_str());
+}
+
+RenderServerStats RenderServer::stats() const {
+    RenderServerStats s;
+    s.accepted = impl->accepted.load();
+    s.rejected = impl->rejected.load();
+    s.expired = impl->expired.load();
+    s.rendered = impl->rendered.load();
+    s.batches = impl->batches.load();
+    s.malformed = impl->malformed.load();
+    s.failed = impl->failed.load();
+    return s;
+}
+
+} // namespace diagram
@@ -0,0 +1,218 @@
+#include "diagram/scene.h"
+#include "diagram/instrumentation.h"
+#include "dependency_graph.h"
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+using namespace std;
+
+namespace diagram {
+
+uint64_t detail::newEditToken() {
+    static atomic<uint64_t> next{1};
+    return next.fetch_add(1, memory_order_relaxed);
+}
+
+static string seriesKey(const string& name) { return "series:" + name; }
+static string axisKey(const string& name) { return "axis:" + name; }
+
+// Batched transform - world to screen over a whole flyweight batch in SoA form;
+// branch-free and alias-free so the compiler emits a vectorized loop
+static void transformToScreen(float* __restrict xs, float* __restrict ys, size_t count,
+                              float originX, float originY, float scaleX, float scaleY) {
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = (xs[i] - originX) * scaleX;
+        ys[i] = (ys[i] - originY) * scaleY;
+    }
+}
+
+// Figures sharing a flyweight are grouped (in first-seen order) and drawn as one instanced batch
+static void drawFigureBatches(const vector<const SceneElement*>& figures, const Viewport& camera, Canvas& frame,
+                              vector<float>& batchX, vector<float>& batchY) {
+    vector<pair<FlyweightFigure*, vector<const SceneElement*>>> batches;
+    unordered_map<FlyweightFigure*, size_t> batchOf;
+    for (auto* e : figures) {
+        auto slot = batchOf.emplace(e->flyweight.get(), batches.size());
+        if (slot.second) batches.push_back({e->flyweight.get(), {}});
+        batches[slot.first->second].second.push_back(e);
+    }
+
+    Bounds area = camera.visibleArea();
+    float scaleX = (float)(camera.screenWidth() / (area.maxX - area.minX));
+    float scaleY = (float)(camera.screenHeight() / (area.maxY - area.minY));
+    int pixelSize = max(1, (int)lround(Scene::kFigureExtent * scaleX));
+    for (auto& batch : batches) {
+        size_t n = batch.second.size();
+        batchX.resize(n);
+        batchY.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            batchX[i] = (float)batch.second[i]->bounds.minX;
+            batchY[i] = (float)batch.second[i]->bounds.minY;
+        }
+        transformToScreen(batchX.data(), batchY.data(), n, (float)area.minX, (float)area.minY, scaleX, scaleY);
+        batch.first->drawBatch(batchX.data(), batchY.data(), n, pixelSize, frame);
+    }
+}
+
+void SceneSnapshot::render(const Viewport& camera, Canvas& frame) const {
+    DIAGRAM_TIME_STAGE(StageRender);
+    Bounds area = camera.visibleArea();
+    vector<const SceneElement*> figures;
+    for (int id : version->index->query(area)) {
+        auto* e = version->elements.get(id);
+        if (e->flyweight && e->bounds.intersects(area)) figures.push_back(e);
+    }
+    frame.reset(camera.screenWidth(), camera.screenHeight());
+    vector<float> batchX, batchY;
+    drawFigureBatches(figures, camera, frame, batchX, batchY);
+}
+
+Scene::Scene() : deps(make_unique<DependencyGraph>()), index(make_unique<SpatialIndex>()) {}
+
+Scene::~Scene() = default;
+
+int Scene::add(string element, string type, string coord, shared_ptr<Diagram> diagram,
+               shared_ptr<FlyweightFigure> flyweight, int requestedId) {
+    int id = requestedId >= 0 && !elements.contains(requestedId) ? requestedId : nextId;
+    nextId = max(nextId, id + 1);
+    // Built field by field: series, axis group, style and axis settings start empty
+    SceneElement e;
+    e.id = id;
+    e.element = element;
+    e.type = std::move(type);
+    e.coord = std::move(coord);
+    e.bounds = boundsAt(element, e.coord);
+    e.diagram = std::move(diagram);
+    e.flyweight = std::move(flyweight);
+    // Graph layouts are driven by their data and axes; figures only by placement and style
+    if (element == "Graph") e.dependsOn |= InputData | InputAxis;
+    index->insert(e.id, e.bounds);
+    elements.set(e.id, std::move(e));
+    return id;
+}
+
+void Scene::remove(int id) {
+    auto* e = find(id);
+    if (!e) return;
+    if (!e->series.empty()) deps->unlink(seriesKey(e->series), id);
+    if (!e->axisGroup.empty()) deps->unlink(axisKey(e->axisGroup), id);
+    index->remove(id, e->bounds);
+    elements.erase(id);
+}
+
+SceneSnapshot Scene::snapshot() {
+    elements.freeze();
+    index->freeze();
+    deps->freeze();
+    auto version = make_shared<SceneVersion>();
+    version->elements = elements.share();
+    version->series = seriesData.freeze();
+    version->axes = axisGroups.freeze();
+    version->index = make_shared<const SpatialIndex>(index->share());
+    version->deps = make_shared<const DependencyGraph>(deps->share());
+    version->nextId = nextId;
+    return SceneSnapshot(std::move(version));
+}
+
+void Scene::restore(const SceneSnapshot& snapshot) {
+    const SceneVersion& v = *snapshot.version;
+    elements = v.elements.share();
+    seriesData.adopt(v.series);
+    axisGroups.adopt(v.axes);
+    *index = v.index->share();
+    *deps = v.deps->share();
+    nextId = v.nextId;
+}
+
+void Scene::move(int id, string coord) {
+    auto* e = find(id);
+    if (!e) return;
+    index->remove(id, e->bounds);
+    e->coord = coord;
+    e->bounds = boundsAt(e->element, coord);
+    index->insert(id, e->bounds);
+    markDirty(*e, InputCoord);
+}
+
+void Scene::bindSeries(int id, string name) {
+    auto* e = find(id);
+    if (!e || e->series == name) return;
+    if (!e->series.empty()) deps->unlink(seriesKey(e->series), id);
+    e->series = name;
+    deps->link(seriesKey(name), id, InputData);
+    markDirty(*e, InputData);
+}
+
+void Scene::updateSeries(const string& name, vector<double> values) {
+    seriesData.edit()[name] = make_shared<const vector<double>>(std::move(values));
+    deps->forEachDependent(seriesKey(name), [&](int id, SceneInput input) { markDirty(*find(id), input); });
+}
+
+void Scene::linkAxis(int id, string group) {
+    auto* e = find(id);
+    if (!e || e->axisGroup == group) return;
+    if (!e->axisGroup.empty()) deps->unlink(axisKey(e->axisGroup), id);
+    e->axisGroup = group;
+    e->axis = axisGroups.edit()[group];
+    deps->link(axisKey(group), id, InputAxis);
+    markDirty(*e, InputAxis);
+}
+
+void Scene::setAxis(const string& group, AxisSettings settings) {
+    axisGroups.edit()[group] = settings;
+    deps->forEachDependent(axisKey(group), [&](int id, SceneInput input) {
+        auto* e = find(id);
+        e->axis = settings;
+        markDirty(*e, input);
+    });
+}
+
+vector<const SceneElement*> Scene::visibleElements() const {
+    Bounds area = camera.visibleArea();
+    vector<const SceneElement*> visible;
+    for (int id : index->query(area)) {
+        auto* e = elements.get(id);
+        if (e->bounds.intersects(area)) visible.push_back(e);
+    }
+    return visible;
+}
+
+void Scene::render() {
+    DIAGRAM_TIME_STAGE(StageRender);
+    vector<int> visible;
+    size_t stale = 0;
+    for (auto* e : visibleElements()) {
+        visible.push_back(e->id);
+        if (e->dirty) ++stale;
+    }
+    out() << "Rendering " << visible.size() << " of " << elements.size() << " elements in viewport ("
+         << stale << " recalculated)\n";
+    frame.reset(camera.screenWidth(), camera.screenHeight());
+
+    // Recalculating clears dirty bits, which may copy chunks a snapshot shares; figures are
+    // resolved once every edit is done so their pointers stay valid
+    vector<int> figureIds;
+    for (int id : visible) {
+        const SceneElement* e = elements.get(id);
+        if (e->dirty) {
+            SceneElement* edited = find(id);
+            edited->diagram->calc();
+            edited->dirty = 0;
+            e = edited;
+        }
+        if (!e->flyweight) {
+            e->diagram->draw();
+            continue;
+        }
+        figureIds.push_back(id);
+    }
+    vector<const SceneElement*> figures;
+    figures.reserve(figureIds.size());
+    for (int id : figureIds) figures.push_back(elements.get(id));
+    drawFigureBatches(figures, camera, frame, batchX, batchY);
+}
+
+} // namespace diagram
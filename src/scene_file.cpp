@@ -0,0 +1,167 @@
+#include "diagram/scene_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace diagram {
+
+// Scene File - Writer; strings (element and flyweight type names, coords, series names) are interned once
+class SceneWriter {
+    string strings;
+    unordered_map<string, uint32_t> interned;
+
+    uint32_t intern(const string& s) {
+        if (s.empty()) return kNoString;
+        auto it = interned.find(s);
+        if (it != interned.end()) return it->second;
+        uint32_t offset = (uint32_t)strings.size();
+        strings.append(s).push_back('\0');
+        interned[s] = offset;
+        return offset;
+    }
+    static uint64_t align8(uint64_t v) { return (v + 7) & ~7ull; }
+public:
+    bool write(const PersistentArray<SceneElement>& elements, const SeriesTable& seriesData, const string& path,
+               uint64_t journalSeq) {
+        strings.clear();
+        interned.clear();
+        vector<const SceneElement*> ordered;
+        ordered.reserve(elements.size());
+        elements.forEach([&](const SceneElement& e) { ordered.push_back(&e); });
+
+        vector<SceneFileElement> table;
+        table.reserve(ordered.size());
+        for (auto* e : ordered) {
+            SceneFileElement r{};
+            r.id = e->id;
+            r.kind = e->element == "Graph" ? KindGraph : KindFigure;
+            r.type = intern(e->type);
+            r.coord = intern(e->coord);
+            r.style = intern(e->style);
+            r.axisGroup = intern(e->axisGroup);
+            r.series = intern(e->series);
+            r.dependsOn = e->dependsOn;
+            r.minX = e->bounds.minX;
+            r.minY = e->bounds.minY;
+            r.maxX = e->bounds.maxX;
+            r.maxY = e->bounds.maxY;
+            r.axisMin = e->axis.min;
+            r.axisMax = e->axis.max;
+            r.axisAuto = e->axis.autoRange;
+            table.push_back(r);
+        }
+        vector<pair<const string*, const vector<double>*>> series;
+        for (auto& entry : seriesData) series.push_back({&entry.first, entry.second.get()});
+        sort(series.begin(), series.end(), [](auto& a, auto& b) { return *a.first < *b.first; });
+        vector<SceneFileSeries> seriesTable;
+        for (auto& entry : series) seriesTable.push_back({intern(*entry.first), 0, entry.second->size(), 0});
+
+        SceneFileHeader h{};
+        memcpy(h.magic, kSceneMagic, sizeof h.magic);
+        h.version = kSceneVersion;
+        h.byteOrder = kByteOrderTag;
+        h.journalSeq = journalSeq;
+        h.elementCount = table.size();
+        h.elementOffset = align8(sizeof h);
+        h.seriesCount = seriesTable.size();
+        h.seriesOffset = align8(h.elementOffset + table.size() * sizeof(SceneFileElement));
+        h.stringTableSize = strings.size();
+        h.stringTableOffset = h.seriesOffset + seriesTable.size() * sizeof(SceneFileSeries);
+        uint64_t blob = align8(h.stringTableOffset + strings.size());
+        for (size_t i = 0; i < seriesTable.size(); ++i) {
+            seriesTable[i].dataOffset = blob;
+            blob += seriesTable[i].count * sizeof(double);
+        }
+        h.fileSize = blob;
+
+        ofstream file(path, ios::binary | ios::trunc);
+        if (!file) return false;
+        auto padTo = [&](uint64_t offset) {
+            static const char zeros[8] = {};
+            uint64_t at = (uint64_t)file.tellp();
+            if (offset > at) file.write(zeros, (streamsize)(offset - at));
+        };
+        file.write((const char*)&h, sizeof h);
+        padTo(h.elementOffset);
+        file.write((const char*)table.data(), (streamsize)(table.size() * sizeof(SceneFileElement)));
+        padTo(h.seriesOffset);
+        file.write((const char*)seriesTable.data(), (streamsize)(seriesTable.size() * sizeof(SceneFileSeries)));
+        file.write(strings.data(), (streamsize)strings.size());
+        for (size_t i = 0; i < series.size(); ++i) {
+            padTo(seriesTable[i].dataOffset);
+            file.write((const char*)series[i].second->data(), (streamsize)(series[i].second->size() * sizeof(double)));
+        }
+        padTo(h.fileSize);
+        return (bool)file;
+    }
+};
+
+bool writeSceneFile(const Scene& scene, const string& path, uint64_t journalSeq) {
+    SceneWriter writer;
+    return writer.write(scene.allElements(), scene.allSeries(), path, journalSeq);
+}
+
+bool writeSceneFile(const SceneSnapshot& snapshot, const string& path, uint64_t journalSeq) {
+    SceneWriter writer;
+    return writer.write(snapshot.allElements(), snapshot.allSeries(), path, journalSeq);
+}
+
+bool SceneView::valid() const {
+    if (length < headerSize(1)) return false;
+    auto& h = header();
+    if ((h.version != 1 && h.version != kSceneVersion) || length < headerSize(h.version)) return false;
+    auto fits = [&](uint64_t offset, uint64_t size) { return offset <= length && size <= length - offset; };
+    return memcmp(h.magic, kSceneMagic, sizeof h.magic) == 0 &&
+           h.byteOrder == kByteOrderTag && h.fileSize == length &&
+           h.elementCount <= length / sizeof(SceneFileElement) &&
+           h.seriesCount <= length / sizeof(SceneFileSeries) &&
+           fits(h.elementOffset, h.elementCount * sizeof(SceneFileElement)) &&
+           fits(h.seriesOffset, h.seriesCount * sizeof(SceneFileSeries)) &&
+           fits(h.stringTableOffset, h.stringTableSize) &&
+           (h.stringTableSize == 0 || base[h.stringTableOffset + h.stringTableSize - 1] == '\0');
+}
+
+SceneView::~SceneView() {
+#ifndef _WIN32
+    if (base) munmap((void*)base, length);
+#endif
+}
+
+unique_ptr<SceneView> SceneView::open(const string& path) {
+    unique_ptr<SceneView> view(new SceneView());
+#ifdef _WIN32
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return nullptr;
+    view->owned.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read(view->owned.data(), (streamsize)view->owned.size());
+    view->base = view->owned.data();
+    view->length = view->owned.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return nullptr;
+    view->base = (const char*)mapped;
+    view->length = (size_t)st.st_size;
+#endif
+    return view->valid() ? std::move(view) : nullptr;
+}
+
+} // namespace diagram
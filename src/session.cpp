@@ -0,0 +1,87 @@
+#include "diagram/session.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace diagram {
+
+struct Session::Impl {
+    struct Document {
+        mutex lock;
+        DiagramFactory factory;
+    };
+    // Sharded so that opening, closing and looking up documents scales with the thread count
+    static constexpr size_t kShards = 64;
+    struct Shard {
+        mutable mutex lock;
+        unordered_map<DocumentId, shared_ptr<Document>> documents;
+    };
+    array<Shard, kShards> shards;
+    atomic<DocumentId> nextId{1};
+
+    Shard& shardOf(DocumentId id) { return shards[id % kShards]; }
+
+    // The shard lock is only held for the lookup; the reference keeps a closed document alive
+    shared_ptr<Document> find(DocumentId id) {
+        Shard& shard = shardOf(id);
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.documents.find(id);
+        return it == shard.documents.end() ? nullptr : it->second;
+    }
+};
+
+Session::Session() : impl(make_unique<Impl>()) {}
+
+Session::~Session() = default;
+
+Session::DocumentId Session::open() {
+    DocumentId id = impl->nextId.fetch_add(1, memory_order_relaxed);
+    auto doc = make_shared<Impl::Document>();
+    Impl::Shard& shard = impl->shardOf(id);
+    lock_guard<mutex> guard(shard.lock);
+    shard.documents.emplace(id, std::move(doc));
+    return id;
+}
+
+bool Session::close(DocumentId id) {
+    shared_ptr<Impl::Document> doc;
+    {
+        Impl::Shard& shard = impl->shardOf(id);
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.documents.find(id);
+        if (it == shard.documents.end()) return false;
+        doc = std::move(it->second);
+        shard.documents.erase(it);
+    }
+    // Wait out a running edit, then release the document outside every lock
+    lock_guard<mutex> guard(doc->lock);
+    return true;
+}
+
+size_t Session::documents() const {
+    size_t total = 0;
+    for (auto& shard : impl->shards) {
+        lock_guard<mutex> guard(shard.lock);
+        total += shard.documents.size();
+    }
+    return total;
+}
+
+bool Session::edit(DocumentId id, const function<void(DiagramFactory&)>& fn) {
+    auto doc = impl->find(id);
+    if (!doc) return false;
+    lock_guard<mutex> guard(doc->lock);
+    fn(doc->factory);
+    return true;
+}
+
+Task<bool> Session::editAsync(DocumentId id, function<void(DiagramFactory&)> fn) {
+    co_await Executor::getInstance().schedule();
+    co_return edit(id, fn);
+}
+
+} // namespace diagram
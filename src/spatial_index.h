@@ -0,0 +1,135 @@
+// Internal - uniform grid index behind Scene's viewport culling.
+#ifndef DIAGRAM_SPATIAL_INDEX_H
+#define DIAGRAM_SPATIAL_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "diagram/persistent.h"
+#include "diagram/scene.h"
+
+namespace diagram {
+
+// Spatial Index - Uniform grid bucketing element ids by the cells their bounds cover; persistent,
+// so scene versions share it. Bounds that are not finite or would cover more than kMaxCells
+// cells go to an overflow list that every query returns
+class SpatialIndex {
+    // A cell's ids as a list of immutable chunks, newest first: versions share the chunks, so
+    // an insert copies at most one chunk however crowded the cell is
+    struct IdChunk {
+        std::vector<int> ids;
+        std::shared_ptr<const IdChunk> next;
+    };
+    using CellIds = std::shared_ptr<const IdChunk>;
+    static constexpr std::size_t kChunk = 32;
+
+    static constexpr double kCellLimit = 1 << 30;  // cell coordinates fit the 32-bit key halves
+    static constexpr double kMaxCells = 4096;
+    double cellSize;
+    PersistentMap<long long, CellIds> cells;
+    PersistentMap<int, bool> overflow;
+
+    static long long key(long long cx, long long cy) { return (cx << 32) ^ (cy & 0xffffffffLL); }
+    // Finite v only; far-away values share the outermost cells
+    long long cellOf(double v) const { return (long long)std::clamp(std::floor(v / cellSize), -kCellLimit, kCellLimit); }
+    static bool finite(const Bounds& b) {
+        return std::isfinite(b.minX) && std::isfinite(b.minY) && std::isfinite(b.maxX) && std::isfinite(b.maxY);
+    }
+    double cellCount(const Bounds& b) const {
+        return std::max(0.0, (double)(cellOf(b.maxX) - cellOf(b.minX) + 1)) *
+               std::max(0.0, (double)(cellOf(b.maxY) - cellOf(b.minY) + 1));
+    }
+    bool gridded(const Bounds& b) const { return finite(b) && cellCount(b) <= kMaxCells; }
+
+    static void add(CellIds& cell, int id) {
+        if (!cell || cell->ids.size() == kChunk) {
+            cell = std::make_shared<const IdChunk>(IdChunk{{id}, cell});
+            return;
+        }
+        auto head = std::make_shared<IdChunk>(*cell);
+        head->ids.push_back(id);
+        cell = std::move(head);
+    }
+    // Copies the chunks from the head down to the one holding id; false if id is absent
+    static bool drop(CellIds& cell, int id) {
+        const IdChunk* c = cell.get();
+        std::vector<const IdChunk*> path;
+        for (; c; c = c->next.get()) {
+            if (std::find(c->ids.begin(), c->ids.end(), id) != c->ids.end()) break;
+            path.push_back(c);
+        }
+        if (!c) return false;
+        CellIds rebuilt = c->next;
+        if (c->ids.size() > 1) {
+            auto copy = std::make_shared<IdChunk>(*c);
+            copy->ids.erase(std::find(copy->ids.begin(), copy->ids.end(), id));
+            rebuilt = std::move(copy);
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) rebuilt = std::make_shared<const IdChunk>(IdChunk{(*it)->ids, rebuilt});
+        cell = std::move(rebuilt);
+        return true;
+    }
+    static void append(const CellIds& cell, std::vector<int>& out) {
+        for (const IdChunk* c = cell.get(); c; c = c->next.get()) out.insert(out.end(), c->ids.begin(), c->ids.end());
+    }
+
+    template <typename Fn>
+    void forEachCell(const Bounds& b, Fn fn) const {
+        for (long long cx = cellOf(b.minX); cx <= cellOf(b.maxX); ++cx)
+            for (long long cy = cellOf(b.minY); cy <= cellOf(b.maxY); ++cy)
+                fn(key(cx, cy));
+    }
+public:
+    explicit SpatialIndex(double cell = 32.0) : cellSize(cell) {}
+    void insert(int id, const Bounds& b) {
+        if (!gridded(b)) {
+            overflow.edit(id) = true;
+            return;
+        }
+        forEachCell(b, [&](long long k) { add(cells.edit(k), id); });
+    }
+    void remove(int id, const Bounds& b) {
+        if (!gridded(b)) {
+            overflow.erase(id);
+            return;
+        }
+        forEachCell(b, [&](long long k) {
+            auto* cell = cells.mutate(k);
+            if (!cell || !drop(*cell, id)) return;
+            if (!*cell) cells.erase(k);
+        });
+    }
+    void freeze() {
+        cells.freeze();
+        overflow.freeze();
+    }
+    SpatialIndex share() const {
+        SpatialIndex copy(cellSize);
+        copy.cells = cells.share();
+        copy.overflow = overflow.share();
+        return copy;
+    }
+    // Candidate ids whose cells overlap the area; callers still test exact bounds
+    std::vector<int> query(const Bounds& area) const {
+        std::vector<int> result;
+        overflow.forEach([&](int id, bool) { result.push_back(id); });
+        if (!finite(area) || cellCount(area) > (double)cells.size()) {
+            // Zoomed far out: walking occupied cells is cheaper than walking the area
+            cells.forEach([&](long long, const CellIds& cell) { append(cell, result); });
+        } else {
+            forEachCell(area, [&](long long k) {
+                if (auto* cell = cells.find(k)) append(*cell, result);
+            });
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+};
+
+} // namespace diagram
+
+#endif // DIAGRAM_SPATIAL_INDEX_H
@@ -0,0 +1,69 @@
+#include "diagram/stream.h"
+#include "diagram/instrumentation.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace diagram {
+
+// Headroom above and below the data, so small moves stay inside the axis
+static double padding(double lo, double hi) {
+    if (hi > lo) return (hi - lo) / 8;
+    return hi != 0 ? fabs(hi) / 8 : 1;
+}
+
+LiveSeries::LiveSeries(size_t capacity, size_t window) : incoming(capacity), points(window ? window : 1) {}
+
+bool LiveSeries::append(double x, double y) {
+    if (incoming.push({x, y})) return true;
+    droppedPoints.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void LiveSeries::accept(const StreamPoint& p) {
+    if (count == points.size()) {
+        uint64_t oldest = seen - count;
+        if (lows.front().first == oldest) lows.pop_front();
+        if (highs.front().first == oldest) highs.pop_front();
+        first = (first + 1) % points.size();
+        --count;
+    }
+    points[(first + count) % points.size()] = p;
+    ++count;
+    while (!lows.empty() && lows.back().second >= p.y) lows.pop_back();
+    lows.push_back({seen, p.y});
+    while (!highs.empty() && highs.back().second <= p.y) highs.pop_back();
+    highs.push_back({seen, p.y});
+    ++seen;
+}
+
+StreamUpdate LiveSeries::refresh() {
+    DIAGRAM_TRACE_SCOPE("stream", "LiveSeries::refresh");
+    StreamUpdate u;
+    size_t before = count;
+    u.added = incoming.drain([&](const StreamPoint& p) { accept(p); });
+    u.scrolledOut = before + u.added - count;
+    size_t dropped = droppedPoints.load(memory_order_relaxed);
+    u.dropped = dropped - droppedReported;
+    droppedReported = dropped;
+    u.size = count;
+    if (count == 0) return u;
+
+    u.x = {at(0).x, at(count - 1).x};
+    double lo = lows.front().second, hi = highs.front().second;
+    double pad = padding(lo, hi);
+    double axisSpan = axisY.max - axisY.min;
+    if (!hasAxis || lo < axisY.min || hi > axisY.max || axisSpan > 2 * (hi - lo + 2 * pad)) {
+        axisY = {lo - pad, hi + pad};
+        hasAxis = true;
+        u.rescaled = true;
+    }
+    u.y = axisY;
+    // Unless rescaled, only the new points' segments are drawn, starting from the point before them
+    size_t kept = count - min(u.added, count);
+    u.redrawFrom = u.rescaled || kept == 0 ? 0 : kept - 1;
+    return u;
+}
+
+} // namespace diagram